@@ -169,6 +169,8 @@ SCOPES_LIBEXPORT int sc_main();
 
 SCOPES_LIBEXPORT sc_i32_i32_i32_tuple_t sc_compiler_version();
 SCOPES_LIBEXPORT int sc_cache_misses();
+SCOPES_LIBEXPORT void sc_time_section_begin(const sc_string_t *name);
+SCOPES_LIBEXPORT void sc_time_section_end();
 
 // compiler
 
@@ -179,12 +181,30 @@ SCOPES_LIBEXPORT sc_valueref_raises_t sc_prove(sc_valueref_t expr);
 SCOPES_LIBEXPORT sc_valueref_raises_t sc_typify(const sc_closure_t *f, int numtypes, const sc_type_t **typeargs);
 SCOPES_LIBEXPORT sc_valueref_raises_t sc_typify_template(sc_valueref_t f, int numtypes, const sc_type_t **typeargs);
 SCOPES_LIBEXPORT sc_valueref_raises_t sc_compile(sc_valueref_t srcl, uint64_t flags);
+// compiled code is not freed by reachability: a function returned by
+// sc_compile stays loaded until it is released with sc_compile_release. the
+// caller asserts that neither the function nor any pointer obtained from it
+// is still in use. sc_compile_collect then unloads every released module that
+// no live module refers to, and returns how many it unloaded; modules that
+// hand out the address of a function or global are never unloaded.
+SCOPES_LIBEXPORT sc_void_raises_t sc_compile_release(sc_valueref_t value);
+SCOPES_LIBEXPORT sc_int_raises_t sc_compile_collect();
+// emits batched functions now, so that errors are reported before they run
+SCOPES_LIBEXPORT sc_void_raises_t sc_compile_flush();
 SCOPES_LIBEXPORT sc_string_raises_t sc_compile_spirv(int version, sc_symbol_t target, sc_valueref_t srcl, uint64_t flags);
 SCOPES_LIBEXPORT sc_string_raises_t sc_compile_glsl(int version, sc_symbol_t target, sc_valueref_t srcl, uint64_t flags);
+SCOPES_LIBEXPORT sc_void_raises_t sc_compile_spirv_batch(int count, const int *versions, const sc_symbol_t *targets, const sc_valueref_t *funcs, const uint64_t *flags, const sc_string_t **results);
+SCOPES_LIBEXPORT sc_void_raises_t sc_compile_glsl_batch(int count, const int *versions, const sc_symbol_t *targets, const sc_valueref_t *funcs, const uint64_t *flags, const sc_string_t **results);
 SCOPES_LIBEXPORT const sc_string_t *sc_spirv_to_glsl(const sc_string_t *binary);
 SCOPES_LIBEXPORT const sc_string_t *sc_default_target_triple();
 SCOPES_LIBEXPORT sc_void_raises_t sc_compile_object(const sc_string_t *target_triple, int file_kind, const sc_string_t *path, const sc_scope_t *table, uint64_t flags);
 SCOPES_LIBEXPORT sc_string_raises_t sc_compile_object_to_buffer(const sc_string_t *target_triple, int file_kind, const sc_string_t *module_name, const sc_scope_t *table, uint64_t flags);
+SCOPES_LIBEXPORT sc_void_raises_t sc_thin_lto_link(const sc_string_t *target_triple, const sc_list_t *inputs, const sc_string_t *path, uint64_t flags);
+SCOPES_LIBEXPORT sc_void_raises_t sc_profile_set_input(const sc_string_t *path);
+SCOPES_LIBEXPORT sc_void_raises_t sc_profile_write(const sc_string_t *path);
+SCOPES_LIBEXPORT sc_void_raises_t sc_profile_reset();
+// entry count of a function compiled with 'profile-use, or 0 without profile
+SCOPES_LIBEXPORT sc_size_raises_t sc_profile_entry_count(sc_valueref_t value);
 SCOPES_LIBEXPORT void sc_enter_solver_cli ();
 SCOPES_LIBEXPORT void sc_show_targets();
 SCOPES_LIBEXPORT sc_valueref_raises_t sc_eval_inline(const sc_anchor_t *anchor, const sc_list_t *expr, const sc_scope_t *scope);
@@ -326,6 +346,8 @@ SCOPES_LIBEXPORT const sc_string_t *sc_dirname(const sc_string_t *path);
 SCOPES_LIBEXPORT const sc_string_t *sc_basename(const sc_string_t *path);
 SCOPES_LIBEXPORT bool sc_is_file(const sc_string_t *path);
 SCOPES_LIBEXPORT bool sc_is_directory(const sc_string_t *path);
+SCOPES_LIBEXPORT bool sc_is_stream(const sc_string_t *path);
+SCOPES_LIBEXPORT uint64_t sc_file_stamp(const sc_string_t *path);
 
 // globals
 
@@ -17,6 +17,16 @@ let llvm.memcpy.p0i8.p0i8.i64 =
     extern 'llvm.memcpy.p0i8.p0i8.i64
         function void (mutable rawstring) rawstring i64 bool
 
+# declare void @llvm.memmove.p0i8.p0i8.i64(i8* <dest>, i8* <src>,
+                                         i64 <len>, i1 <isvolatile>)
+let llvm.memmove.p0i8.p0i8.i64 =
+    extern 'llvm.memmove.p0i8.p0i8.i64
+        function void (mutable rawstring) rawstring i64 bool
+
+let realloc =
+    extern 'realloc
+        function (mutable voidstar) voidstar usize
+
 fn iParent (i)
     (i - 1:i64) // 2
 
@@ -25,6 +35,76 @@ fn iLeftChild (i)
 fn iRightChild (i)
     2:i64 * i + 2:i64
 
+# partitions smaller than this are insertion sorted
+let INSERTION_SORT_THRESHOLD = 24:i64
+# partitions larger than this use the pseudomedian of nine as pivot
+let NINTHER_THRESHOLD = 128:i64
+# element moves a partial insertion sort may perform before giving up
+let PARTIAL_INSERTION_SORT_LIMIT = 8:i64
+# runs smaller than this are insertion sorted by the stable sort
+let STABLE_INSERTION_SORT_THRESHOLD = 32:i64
+
+fn ilog2 (n)
+    loop (n log = n 0:i64)
+        if (n <= 1:i64)
+            break log
+        _ (n >> 1:i64) (log + 1:i64)
+
+# move `count` elements from `src` to `dest` without copying or dropping them
+inline move-items (dest src count)
+    llvm.memcpy.p0i8.p0i8.i64
+        bitcast dest (mutable rawstring)
+        bitcast src rawstring
+        (count as i64) * ((sizeof (elementof (typeof dest))) as i64)
+        false
+
+# like `move-items`, but `dest` and `src` may overlap
+inline shift-items (dest src count)
+    llvm.memmove.p0i8.p0i8.i64
+        bitcast dest (mutable rawstring)
+        bitcast src rawstring
+        (count as i64) * ((sizeof (elementof (typeof dest))) as i64)
+        false
+
+# copy `count` elements from `src` to uninitialized `dest`; plain elements are
+    copied in bulk
+inline copy-items (dest src count)
+    let ET = (elementof (typeof dest))
+    static-if (plain? ET)
+        move-items dest src count
+    else
+        for i in (range count)
+            assign (copy (src @ i)) (dest @ i)
+
+# map a radix sort key to an unsigned integer of the same size whose order
+    matches the order of the key
+inline radix-bits (k)
+    let k = (deref k)
+    let T = (typeof k)
+    static-match T
+    case u8 k
+    case u16 k
+    case u32 k
+    case u64 k
+    case i8 ((bitcast k u8) ^ 0x80:u8)
+    case i16 ((bitcast k u16) ^ 0x8000:u16)
+    case i32 ((bitcast k u32) ^ 0x80000000:u32)
+    case i64 ((bitcast k u64) ^ 0x8000000000000000:u64)
+    case f32
+        let u = (bitcast k u32)
+        ? ((u & 0x80000000:u32) == 0:u32) (u | 0x80000000:u32) (~ u)
+    case f64
+        let u = (bitcast k u64)
+        ? ((u & 0x8000000000000000:u64) == 0:u64)
+            u | 0x8000000000000000:u64
+            ~ u
+    default
+        static-error "radix sort key must be an integer or real"
+
+inline radix-digit (bits pass)
+    let T = (typeof bits)
+    ((bits >> ((pass * 8:usize) as T)) & (0xff as T)) as usize
+
 inline... array-generator (self, offset : usize = 0:usize)
     Generator
         inline () offset
@@ -106,8 +186,7 @@ typedef+ Array
         assert (self._count > 0) "empty array has no last element"
         self._items @ (self._count - 1:usize)
 
-    @@ memo
-    inline gen-sort (key predicate)
+    inline gen-sort-primitives (key predicate)
         let key =
             static-if (none? key)
                 inline (x) x
@@ -117,6 +196,28 @@ typedef+ Array
                 inline (a b) (< a b)
             else predicate
 
+        inline less? (a b ...)
+            pred (key a ...) (key b ...) ...
+
+        inline swap-items (items a b)
+            swap (items @ a) (items @ b)
+
+        # stable; only swaps neighbours that are strictly out of order
+        fn insertion-sort (items begin end ...)
+            loop (i = (begin + 1:i64))
+                if (i >= end)
+                    break;
+                loop (j = i)
+                    if (j <= begin)
+                        break;
+                    let a = (items @ (j - 1:i64))
+                    let b = (items @ j)
+                    if (not (less? b a ...))
+                        break;
+                    swap a b
+                    j - 1:i64
+                i + 1:i64
+
         fn siftDown (items start end ...)
             loop (root = start)
                 if ((iLeftChild root) > end)
@@ -144,7 +245,7 @@ typedef+ Array
                 else
                     step1 root v_root k_root
 
-        fn "sort-array" (items count ...)
+        fn heap-sort (items count ...)
             let count-1 = (count - 1:i64)
 
             # heapify
@@ -164,10 +265,311 @@ typedef+ Array
                 siftDown items 0:i64 end ...
                 repeat end
 
+        _ less? swap-items insertion-sort heap-sort
+
+    @@ memo
+    inline gen-sort (key predicate)
+        let less? swap-items insertion-sort heap-sort =
+            gen-sort-primitives key predicate
+
+        inline sort2 (items a b ...)
+            if (less? (items @ b) (items @ a) ...)
+                swap-items items a b
+
+        inline sort3 (items a b c ...)
+            sort2 items a b ...
+            sort2 items b c ...
+            sort2 items a b ...
+
+        # insertion sort that gives up after a few moves; returns true if
+            the range could be sorted
+        fn partial-insertion-sort (items begin end ...)
+            loop (i limit = (begin + 1:i64) 0:i64)
+                if (i >= end)
+                    break true
+                if (limit > PARTIAL_INSERTION_SORT_LIMIT)
+                    break false
+                let j =
+                    loop (j = i)
+                        if (j <= begin)
+                            break j
+                        let a = (items @ (j - 1:i64))
+                        let b = (items @ j)
+                        if (not (less? b a ...))
+                            break j
+                        swap a b
+                        j - 1:i64
+                _ (i + 1:i64) (limit + (i - j))
+
+        # partition around the pivot at `begin`; elements equal to the pivot
+            go to the right. returns the final pivot position and whether the
+            range was already partitioned.
+        fn partition-right (items begin end ...)
+            let pivot = (items @ begin)
+            let first =
+                loop (first = (begin + 1:i64))
+                    if ((first < end) and (less? (items @ first) pivot ...))
+                        repeat (first + 1:i64)
+                    break first
+            let last =
+                if ((first - 1:i64) == begin)
+                    loop (last = end)
+                        let last = (last - 1:i64)
+                        if ((first < last) and (not (less? (items @ last) pivot ...)))
+                            repeat last
+                        break last
+                else
+                    loop (last = end)
+                        let last = (last - 1:i64)
+                        if ((last > begin) and (not (less? (items @ last) pivot ...)))
+                            repeat last
+                        break last
+            let already-partitioned = (first >= last)
+            let first =
+                loop (first last = first last)
+                    if (first >= last)
+                        break first
+                    swap-items items first last
+                    let first =
+                        loop (first = (first + 1:i64))
+                            if (less? (items @ first) pivot ...)
+                                repeat (first + 1:i64)
+                            break first
+                    let last =
+                        loop (last = (last - 1:i64))
+                            if (not (less? (items @ last) pivot ...))
+                                repeat (last - 1:i64)
+                            break last
+                    _ first last
+            let pivot-pos = (first - 1:i64)
+            if (pivot-pos != begin)
+                swap-items items begin pivot-pos
+            _ pivot-pos already-partitioned
+
+        # partition around the pivot at `begin`; elements equal to the pivot
+            go to the left. used when the pivot equals the element preceding
+            the range, which means the range holds many equal elements.
+        fn partition-left (items begin end ...)
+            let pivot = (items @ begin)
+            let last =
+                loop (last = (end - 1:i64))
+                    if (less? pivot (items @ last) ...)
+                        repeat (last - 1:i64)
+                    break last
+            let first =
+                if ((last + 1:i64) == end)
+                    loop (first = (begin + 1:i64))
+                        if ((first < last) and (not (less? pivot (items @ first) ...)))
+                            repeat (first + 1:i64)
+                        break first
+                else
+                    loop (first = (begin + 1:i64))
+                        if ((first < end) and (not (less? pivot (items @ first) ...)))
+                            repeat (first + 1:i64)
+                        break first
+            let last =
+                loop (first last = first last)
+                    if (first >= last)
+                        break last
+                    swap-items items first last
+                    let last =
+                        loop (last = (last - 1:i64))
+                            if (less? pivot (items @ last) ...)
+                                repeat (last - 1:i64)
+                            break last
+                    let first =
+                        loop (first = (first + 1:i64))
+                            if (not (less? pivot (items @ first) ...))
+                                repeat (first + 1:i64)
+                            break first
+                    _ first last
+            if (last != begin)
+                swap-items items begin last
+            last
+
+        # pattern-defeating quicksort (Orson Peters); falls back to heapsort
+            once too many unbalanced partitions have been encountered
+        fn pdqsort-loop (items begin end bad-allowed leftmost ...)
+            returning void
+            loop (begin bad-allowed leftmost = begin bad-allowed leftmost)
+                let size = (end - begin)
+                if (size < INSERTION_SORT_THRESHOLD)
+                    insertion-sort items begin end ...
+                    break;
+
+                # choose pivot as median of 3 or pseudomedian of 9
+                let s2 = (size // 2:i64)
+                if (size > NINTHER_THRESHOLD)
+                    sort3 items begin (begin + s2) (end - 1:i64) ...
+                    sort3 items (begin + 1:i64) (begin + s2 - 1:i64) (end - 2:i64) ...
+                    sort3 items (begin + 2:i64) (begin + s2 + 1:i64) (end - 3:i64) ...
+                    sort3 items (begin + s2 - 1:i64) (begin + s2) (begin + s2 + 1:i64) ...
+                    swap-items items begin (begin + s2)
+                else
+                    sort3 items (begin + s2) begin (end - 1:i64) ...
+
+                # if the pivot equals the element before this range, all
+                    elements equal to it can be skipped
+                if ((not leftmost) and (not (less? (items @ (begin - 1:i64)) (items @ begin) ...)))
+                    repeat ((partition-left items begin end ...) + 1:i64) bad-allowed false
+
+                let pivot-pos already-partitioned =
+                    partition-right items begin end ...
+                let l-size = (pivot-pos - begin)
+                let r-size = (end - (pivot-pos + 1:i64))
+                let highly-unbalanced? =
+                    (l-size < (size // 8:i64)) or (r-size < (size // 8:i64))
+                let bad-allowed =
+                    if highly-unbalanced?
+                        let bad-allowed = (bad-allowed - 1:i64)
+                        if (bad-allowed == 0:i64)
+                            heap-sort (getelementptr items begin) size ...
+                            break;
+                        # shuffle some elements to break patterns
+                        if (l-size >= INSERTION_SORT_THRESHOLD)
+                            let q = (l-size // 4:i64)
+                            swap-items items begin (begin + q)
+                            swap-items items (pivot-pos - 1:i64) (pivot-pos - q)
+                            if (l-size > NINTHER_THRESHOLD)
+                                swap-items items (begin + 1:i64) (begin + q + 1:i64)
+                                swap-items items (begin + 2:i64) (begin + q + 2:i64)
+                                swap-items items (pivot-pos - 2:i64) (pivot-pos - q - 1:i64)
+                                swap-items items (pivot-pos - 3:i64) (pivot-pos - q - 2:i64)
+                        if (r-size >= INSERTION_SORT_THRESHOLD)
+                            let q = (r-size // 4:i64)
+                            swap-items items (pivot-pos + 1:i64) (pivot-pos + q + 1:i64)
+                            swap-items items (end - 1:i64) (end - q)
+                            if (r-size > NINTHER_THRESHOLD)
+                                swap-items items (pivot-pos + 2:i64) (pivot-pos + q + 2:i64)
+                                swap-items items (pivot-pos + 3:i64) (pivot-pos + q + 3:i64)
+                                swap-items items (end - 2:i64) (end - q - 1:i64)
+                                swap-items items (end - 3:i64) (end - q - 2:i64)
+                        bad-allowed
+                    else
+                        # well balanced and no swaps: try to finish both
+                            sides with a bounded insertion sort
+                        if already-partitioned
+                            if (partial-insertion-sort items begin pivot-pos ...)
+                                if (partial-insertion-sort items (pivot-pos + 1:i64) end ...)
+                                    break;
+                        bad-allowed
+
+                # recurse into the left side, loop on the right side
+                this-function items begin pivot-pos bad-allowed leftmost ...
+                _ (pivot-pos + 1:i64) bad-allowed false
+
+        fn "sort-array" (items count ...)
+            if (count > 1:i64)
+                pdqsort-loop items 0:i64 count (ilog2 count) true ...
+
+    @@ memo
+    inline gen-stable-sort (key predicate)
+        let less? swap-items insertion-sort heap-sort =
+            gen-sort-primitives key predicate
+
+        # top-down merge sort; presorted neighbouring runs are not merged,
+            which makes sorted and nearly sorted input linear
+        fn merge-sort (items scratch begin end ...)
+            returning void
+            let size = (end - begin)
+            if (size <= STABLE_INSERTION_SORT_THRESHOLD)
+                insertion-sort items begin end ...
+                return;
+            let mid = (begin + (size // 2:i64))
+            this-function items scratch begin mid ...
+            this-function items scratch mid end ...
+            if (not (less? (items @ mid) (items @ (mid - 1:i64)) ...))
+                return;
+            # move the left run out of the way and merge back into place
+            let nl = (mid - begin)
+            move-items scratch (getelementptr items begin) nl
+            loop (i j k = 0:i64 mid begin)
+                if (i == nl)
+                    break;
+                if (j == end)
+                    move-items (getelementptr items k) (getelementptr scratch i) (nl - i)
+                    break;
+                # take from the left run unless the right one is strictly
+                    smaller, which keeps equal elements in order
+                if (less? (items @ j) (scratch @ i) ...)
+                    move-items (getelementptr items k) (getelementptr items j) 1
+                    _ i (j + 1:i64) (k + 1:i64)
+                else
+                    move-items (getelementptr items k) (getelementptr scratch i) 1
+                    _ (i + 1:i64) j (k + 1:i64)
+            ;
+
+        fn "stable-sort-array" (items count ...)
+            if (count > 1:i64)
+                let ET = (elementof (typeof items))
+                let scratch =
+                    malloc-array ET (((count // 2:i64) + 1:i64) as usize)
+                merge-sort items scratch 0:i64 count ...
+                free scratch
+
+    @@ memo
+    inline gen-radix-sort (key)
+        let key =
+            static-if (none? key)
+                inline (x) x
+            else key
+
+        # LSD radix sort over the bytes of the mapped key; passes in which
+            all keys share the same digit are skipped
+        fn "radix-sort-array" (items count ...)
+            if (count < 2:i64)
+                return;
+            let ET = (elementof (typeof items))
+            let BT = (typeof (radix-bits (key (items @ 0) ...)))
+            let passes = (sizeof BT)
+            let keys = (malloc-array BT (count as usize))
+            let scratch-keys = (malloc-array BT (count as usize))
+            let scratch = (malloc-array ET (count as usize))
+            local histogram : (array usize 2048)
+            for i in (range count)
+                let bits = (radix-bits (key (items @ i) ...))
+                keys @ i = bits
+                for pass in (range passes)
+                    let idx = (pass * 256:usize + (radix-digit bits pass))
+                    histogram @ idx += 1:usize
+            local offsets : (array usize 256)
+            let swapped? =
+                loop (pass src dst src-keys dst-keys swapped? =
+                        0:usize items scratch keys scratch-keys false)
+                    if (pass == passes)
+                        break swapped?
+                    let base = (pass * 256:usize)
+                    let digit = (radix-digit (src-keys @ 0) pass)
+                    if ((histogram @ (base + digit)) == (count as usize))
+                        repeat (pass + 1:usize) src dst src-keys dst-keys swapped?
+                    loop (d sum = 0:usize 0:usize)
+                        if (d == 256:usize)
+                            break;
+                        let n = (deref (histogram @ (base + d)))
+                        offsets @ d = sum
+                        _ (d + 1:usize) (sum + n)
+                    for i in (range count)
+                        let bits = (deref (src-keys @ i))
+                        let d = (radix-digit bits pass)
+                        let o = (deref (offsets @ d))
+                        dst-keys @ o = bits
+                        move-items (getelementptr dst o) (getelementptr src i) 1
+                        offsets @ d = o + 1:usize
+                    _ (pass + 1:usize) dst src dst-keys src-keys (not swapped?)
+            if swapped?
+                move-items items scratch count
+            free scratch
+            free scratch-keys
+            free keys
+
     """"Sort elements of array `self` from smallest to largest, either using
         the `<` operator supplied by the element type, or by using the key
         supplied by the callable `key`, which is expected to return a comparable
         value for each element value supplied.
+
+        The sort is not stable; it uses pattern-defeating quicksort, which
+        runs in linear time on sorted, reverse sorted and many-duplicate
+        inputs and falls back to heapsort on adversarial ones.
     inline sort (self key ...)
         (gen-sort key) (deref self._items) ((deref self._count) as i64) ...
 
@@ -179,6 +581,24 @@ typedef+ Array
     inline predicated-sort (self predicate ...)
         (gen-sort (predicate = predicate)) (deref self._items) ((deref self._count) as i64) ...
 
+    """"Sort elements of array `self` like `sort`, but keep elements that
+        compare equal in their original order. Uses a merge sort with a
+        scratch buffer of half the array's size.
+    inline stable-sort (self key ...)
+        (gen-stable-sort key) (deref self._items) ((deref self._count) as i64) ...
+
+    """"Sort elements of array `self` like `predicated-sort`, but keep elements
+        that compare equal in their original order.
+    inline predicated-stable-sort (self predicate ...)
+        (gen-stable-sort (predicate = predicate)) (deref self._items) ((deref self._count) as i64) ...
+
+    """"Sort elements of array `self` from smallest to largest with a stable
+        LSD radix sort. Elements must be integers or reals, or `key` must map
+        each element to an integer or real. Allocates a scratch buffer the
+        size of the array.
+    inline radix-sort (self key ...)
+        (gen-radix-sort key) (deref self._items) ((deref self._count) as i64) ...
+
     fn append-slots (self n)
         let idx = (deref self._count)
         let new-count = (idx + n)
@@ -220,14 +640,15 @@ typedef+ Array
         If index is omitted, `insert` operates like `append`.
     define insert
         fn _insert (self value index)
+            let index = (index as usize)
             let count = (deref self._count)
             assert (index <= count) "insertion index out of bounds"
             append-slots self 1:usize
-            let items = self._items
-            for i in (rrange index count)
-                assign (dupe (items @ i)) (items @ (i + 1))
-            let slot = (self._items @ index)
-            assign value slot
+            let items = (deref self._items)
+            shift-items (getelementptr items (index + 1)) (getelementptr items index)
+                count - index
+            let slot = (items @ index)
+            assign (imply value ((typeof self) . ElementType)) slot
             slot
         inline... insert
         case (self, value)
@@ -246,16 +667,73 @@ typedef+ Array
     """"Remove element at index from array `self` and return it.
         This operation offsets the index of each following element by -1.
     fn remove (self index)
+        let index = (index as usize)
         let &count = self._count
         assert (index < &count) "can't remove from empty array"
         &count -= 1
-        let items = self._items
+        let items = (deref self._items)
         let result =
             dupe (deref (items @ index))
-        for i in (range index &count)
-            assign (dupe (items @ (i + 1))) (items @ i)
+        shift-items (getelementptr items index) (getelementptr items (index + 1))
+            &count - index
         result
 
+    fn append-items (self src count)
+        let count = (count as usize)
+        let dest = (& (append-slots self count))
+        copy-items dest src count
+        return;
+
+    """"Append `count` elements read from pointer `src` to the end of array
+        `self`, or, if `count` is omitted, all elements of the array `src`.
+        Elements are copied; arrays of plain element types are copied in
+        bulk. `src` must not point into `self`.
+    inline append-many (self src count)
+        static-if (none? count)
+            append-items self (deref src._items) (countof src)
+        else
+            append-items self src count
+
+    fn insert-items (self index src count)
+        let index = (index as usize)
+        let count = (count as usize)
+        let oldcount = (deref self._count)
+        assert (index <= oldcount) "insertion index out of bounds"
+        append-slots self count
+        let items = (deref self._items)
+        shift-items (getelementptr items (index + count)) (getelementptr items index)
+            oldcount - index
+        copy-items (getelementptr items index) src count
+        return;
+
+    """"Insert `count` elements read from pointer `src` at `index` into the
+        array `self`, or, if `count` is omitted, all elements of the array
+        `src`. This operation offsets the index of each following element by
+        the number of inserted elements. `src` must not point into `self`.
+    inline insert-range (self index src count)
+        static-if (none? count)
+            insert-items self index (deref src._items) (countof src)
+        else
+            insert-items self index src count
+
+    """"Remove and drop all elements in the index range `begin` to `end`
+        (exclusive) from array `self`. This operation offsets the index of
+        each following element by `begin - end`.
+    fn remove-range (self begin end)
+        let begin = (begin as usize)
+        let end = (end as usize)
+        let &count = self._count
+        assert (begin <= end) "invalid range"
+        assert (end <= &count) "range out of bounds"
+        let items = (deref self._items)
+        static-if (not (plain? ((typeof self) . ElementType)))
+            for idx in (range begin end)
+                __drop (items @ idx)
+        shift-items (getelementptr items begin) (getelementptr items end)
+            &count - end
+        &count -= end - begin
+        return;
+
     """"Clear the array and reset its element count to zero. This will drop
         all elements that have been previously contained by the array.
     fn clear (self)
@@ -300,12 +778,7 @@ typedef+ Array
         let T = (typeof self)
         let capacity = ('capacity self)
         let new-items = (malloc-array T.ElementType capacity)
-        loop (idx = 0)
-            if (idx < count)
-                assign (copy (old-items @ idx)) (new-items @ idx)
-                repeat (idx + 1)
-            else
-                break;
+        copy-items new-items old-items count
         assign new-items newarr._items
         newarr
 
@@ -321,7 +794,8 @@ typedef+ Array
                                 break false
                         else true
 
-    unlet gen-sort append-slots
+    unlet gen-sort-primitives gen-sort gen-stable-sort gen-radix-sort
+        \ append-slots append-items insert-items
 
 ################################################################################
 
@@ -499,16 +973,13 @@ typedef+ GrowingArray
             let new-capacity =
                 nearest-capacity (deref self._capacity) count
             let T = (typeof self)
-            let count = (deref self._count)
-            let old-items = (deref self._items)
-            let new-items = (malloc-array T.ElementType new-capacity)
-            llvm.memcpy.p0i8.p0i8.i64
-                bitcast (view new-items) (mutable rawstring)
-                bitcast old-items rawstring
-                (count * (sizeof T.ElementType)) as i64
-                false
-            free old-items
-            assign new-items self._items
+            # elements are always moved bitwise, so the allocator is free to
+                relocate them
+            let new-items =
+                realloc (bitcast (deref self._items) voidstar)
+                    new-capacity * (sizeof T.ElementType)
+            assert (new-items != null) "out of memory"
+            self._items = (bitcast new-items (mutable pointer T.ElementType))
             self._capacity = new-capacity
         return;
 
@@ -0,0 +1,246 @@
+#
+    The Scopes Compiler Infrastructure
+    This file is distributed under the MIT License.
+    See LICENSE.md for details.
+
+""""ConcurrentMap
+    =============
+
+    This module implements a key -> value store that can be shared between
+    threads.
+
+    The map is split into a fixed number of shards, each of which is a `Map`
+    guarded by its own reader-writer spin lock. The upper bits of the key hash
+    select the shard, so that threads working on different keys rarely contend
+    for the same lock. Readers of a shard don't exclude each other; a reader
+    only performs a single atomic increment and decrement. A waiting writer
+    makes newly arriving readers back off until it has taken and released the
+    lock, so that writers aren't starved by a steady stream of readers.
+    Lookups return copies of the stored values, since a reference would
+    outlive the lock.
+
+using import struct
+using import Map
+
+let yield-thread =
+    static-if (operating-system == 'windows)
+        extern 'SwitchToThread (function i32)
+    else
+        extern 'sched_yield (function i32)
+
+# number of shards; must be a power of two
+let SHARD_BITS = 6:u64
+let SHARD_COUNT = (1:u64 << SHARD_BITS)
+# shards are padded to this size so that their locks don't share cache lines
+let CACHE_LINE = 64:usize
+# set by a writer waiting for the readers to leave; new readers back off
+let PENDING = 0x20000000
+# replaces PENDING once the writer holds the lock
+let WRITER = -0x40000000
+let BLOCKED = (WRITER | PENDING)
+# the bits counting readers
+let READERS = (PENDING - 1)
+
+inline read-lock (lock)
+    loop ()
+        if (((atomicrmw add lock 1) & BLOCKED) == 0)
+            break;
+        atomicrmw sub lock 1
+        (yield-thread)
+        repeat;
+
+inline read-unlock (lock)
+    atomicrmw sub lock 1
+    ;
+
+inline write-lock (lock)
+    # announce the writer so that arriving readers back off
+    # only one writer can be pending or holding the lock at a time
+    loop (expected = 0)
+        let old announced? = (cmpxchg lock expected (expected | PENDING))
+        if announced?
+            break;
+        if ((old & BLOCKED) != 0)
+            (yield-thread)
+        repeat (old & READERS)
+    # then wait for the readers that came before to leave
+    loop ()
+        let old locked? = (cmpxchg lock PENDING WRITER)
+        if locked?
+            break;
+        (yield-thread)
+        repeat;
+
+inline write-unlock (lock)
+    atomicrmw sub lock WRITER
+    ;
+
+typedef ConcurrentMap < Struct
+    @@ memo
+    inline gen-type (key-type value-type hash-function)
+        let parent-type = this-type
+        let hash-function =
+            static-if (none? hash-function) hash
+            else hash-function
+        let MapType = (Map key-type value-type hash-function)
+        let used-size = ((sizeof MapType) + (sizeof i32))
+        let PadType =
+            array u8 ((CACHE_LINE - (used-size % CACHE_LINE)) % CACHE_LINE)
+        let ShardType =
+            struct (.. "<ConcurrentMap.Shard " (tostring key-type) "=" (tostring value-type) ">")
+                lock : i32 = 0
+                map : MapType
+                _pad : PadType = (nullof PadType)
+        struct (.. "<ConcurrentMap " (tostring key-type) "=" (tostring value-type) ">") < parent-type
+            let KeyType = key-type
+            let ValueType = value-type
+            let HashFunction = hash-function
+            let MapType = MapType
+            let ShardType = ShardType
+
+            _shards : (mutable pointer ShardType)
+
+    inline shard-of (self key)
+        let selfT = (typeof self)
+        let keyhash = ((selfT.HashFunction (key as selfT.KeyType)) as u64)
+        # Map picks slots with the lower bits, so use the upper ones here
+        self._shards @ (keyhash >> (64:u64 - SHARD_BITS))
+
+    inline reading (shard f)
+        read-lock (& shard.lock)
+        let result... = (f shard.map)
+        read-unlock (& shard.lock)
+        result...
+
+    inline writing (shard f)
+        write-lock (& shard.lock)
+        let result... = (f shard.map)
+        write-unlock (& shard.lock)
+        result...
+
+    fn set (self key value)
+        """"Inserts a new key -> value association into the map. If the key
+            already exists, it will be updated.
+        writing (shard-of self key)
+            inline (map)
+                'set map key value
+
+    fn in? (self key)
+        reading (shard-of self key)
+            inline (map)
+                'in? map key
+
+    @@ memo
+    inline __rin (elemT cls)
+        let KeyType = cls.KeyType
+        static-if (imply? elemT KeyType)
+            inline (key self)
+                in? self (imply key KeyType)
+
+    fn getdefault (self key value)
+        """"Returns a copy of the value associated with key or `value` if the
+            key does not exist.
+        reading (shard-of self key)
+            inline (map)
+                copy ('getdefault map key value)
+
+    fn get (self key)
+        """"Returns a copy of the value associated with key or raises an error.
+        let shard = (shard-of self key)
+        read-lock (& shard.lock)
+        try
+            let value = (copy ('get shard.map key))
+            read-unlock (& shard.lock)
+            value
+        except (err)
+            read-unlock (& shard.lock)
+            raise err
+
+    fn get-or-insert (self key constructor)
+        """"Returns a copy of the value associated with key. If the key does
+            not exist, `constructor` is called with the key to create the
+            value, which is then inserted. Of several threads inserting the
+            same key at the same time, only one calls `constructor`.
+        let shard = (shard-of self key)
+        # fast path: the key exists and other readers can proceed
+        read-lock (& shard.lock)
+        if ('in? shard.map key)
+            let value = (copy ('get shard.map key))
+            read-unlock (& shard.lock)
+            return value
+        read-unlock (& shard.lock)
+        writing shard
+            inline (map)
+                # another writer may have inserted the key in the meantime
+                if (not ('in? map key))
+                    'set map key (constructor key)
+                copy ('get map key)
+
+    fn discard (self key)
+        """"Erases a key -> value association from the map; if the map does not
+            contain this key, nothing happens.
+        writing (shard-of self key)
+            inline (map)
+                'discard map key
+
+    fn pop (self key)
+        """"Erases a key -> value association from the map and pops the old
+            value or raises an error.
+        let shard = (shard-of self key)
+        write-lock (& shard.lock)
+        try
+            let value = ('pop shard.map key)
+            write-unlock (& shard.lock)
+            value
+        except (err)
+            write-unlock (& shard.lock)
+            raise err
+
+    inline for-each (self f)
+        """"Calls `f` with every key and value in the map. Shards are visited
+            one after another; only the shard being visited is locked for
+            reading, so concurrent writes to other shards may or may not be
+            observed.
+        for i in (range SHARD_COUNT)
+            reading (self._shards @ i)
+                inline (map)
+                    for key value in map
+                        f key value
+
+    fn clear (self)
+        for i in (range SHARD_COUNT)
+            writing (self._shards @ i)
+                inline (map)
+                    'clear map
+
+    inline __countof (self)
+        """"Returns the number of keys in the map; while other threads modify
+            the map, the result is only an estimate.
+        fold (count = 0:usize) for i in (range SHARD_COUNT)
+            count +
+                reading (self._shards @ i)
+                    inline (map) (countof map)
+
+    fn __drop (self)
+        returning void
+        for i in (range SHARD_COUNT)
+            __drop (self._shards @ i)
+        free self._shards
+        _;
+
+    inline __typecall (cls opts...)
+        static-if (cls == this-type)
+            let key-type value-type function-type = opts...
+            gen-type key-type value-type function-type
+        else
+            let shards = (malloc-array cls.ShardType SHARD_COUNT)
+            for i in (range SHARD_COUNT)
+                assign (cls.ShardType (map = (cls.MapType))) (shards @ i)
+            Struct.__typecall cls
+                _shards = shards
+
+    unlet gen-type shard-of reading writing
+
+do
+    let ConcurrentMap
+    locals;
@@ -10,6 +10,11 @@
     module provides a strong reference type `Rc`, as well as a weak reference
     type `Weak`.
 
+    `Arc` and `AtomicWeak` are variants that update their reference counts
+    with atomic operations, so that handles to the same value can be copied
+    and dropped from multiple threads. They share layout and API with `Rc`
+    and `Weak`; switching between the two only requires changing the type.
+
 define DEBUG_DOUBLE_FREES false
 
 let
@@ -36,6 +41,52 @@ inline _baseptr (self)
 
 typedef Weak < ReferenceCounted
 typedef Rc < ReferenceCounted
+typedef AtomicWeak < Weak
+typedef Arc < Rc
+
+# increment the reference count at `refcount` and return the new count
+inline rc-inc (atomic? refcount)
+    static-if atomic?
+        add (atomicrmw add refcount 1) 1
+    else
+        let rc = (add (load refcount) 1)
+        store rc refcount
+        rc
+
+# decrement the reference count at `refcount` and return the new count
+inline rc-dec (atomic? refcount)
+    static-if atomic?
+        sub (atomicrmw sub refcount 1) 1
+    else
+        let rc = (sub (load refcount) 1)
+        store rc refcount
+        rc
+
+inline rc-load (atomic? refcount)
+    static-if atomic?
+        atomicrmw add refcount 0
+    else
+        load refcount
+
+# increment the strong reference count at `refcount` unless it is zero;
+    returns true on success
+inline rc-try-acquire (atomic? refcount)
+    static-if atomic?
+        loop (rc = 1)
+            assert (rc >= 0) "corrupt refcount encountered"
+            if (rc == 0)
+                break false
+            let old ok = (cmpxchg refcount rc (add rc 1))
+            if ok
+                break true
+            old
+    else
+        let rc = (load refcount)
+        assert (rc >= 0) "corrupt refcount encountered"
+        if (rc == 0) false
+        else
+            store (add rc 1) refcount
+            true
 
 let use-rc free-rc =
     static-if DEBUG_DOUBLE_FREES
@@ -59,27 +110,31 @@ let use-rc free-rc =
         _ (inline ()) (inline ())
 
 @@ memo
-inline gen-type (T)
+inline gen-type (T atomic?)
     let storage-type =
         mutable pointer T
     let WeakType =
-        typedef (.. "<Weak " (tostring T) ">") < Weak
+        typedef
+            .. (static-if atomic? "<AtomicWeak " else "<Weak ") (tostring T) ">"
+            \ < (static-if atomic? AtomicWeak else Weak)
             \ :: storage-type
     let RcType =
-        typedef (.. "<Rc " (tostring T) ">") < Rc
+        typedef
+            .. (static-if atomic? "<Arc " else "<Rc ") (tostring T) ">"
+            \ < (static-if atomic? Arc else Rc)
             \ :: storage-type
 
     typedef+ WeakType
         let Type = T
         let RcType = RcType
+        let Atomic? = atomic?
 
         inline... __typecall
         case (cls, value : RcType)
             let md = (_mdptr value)
             let refcount =
                 getelementptr md 0 WEAKRC_INDEX
-            let rc = (add (load refcount) 1)
-            store rc refcount
+            rc-inc atomic? refcount
             bitcast (dupe (view value)) this-type
         case (cls)
             # null-weak that will never upgrade
@@ -88,6 +143,7 @@ inline gen-type (T)
     typedef+ RcType
         let Type = T
         let WeakType = WeakType
+        let Atomic? = atomic?
 
         fn wrap (value)
             let self = (nullof storage-type)
@@ -100,7 +156,9 @@ inline gen-type (T)
             store value self
             let mdptr = (_mdptr self)
             store 1 (getelementptr mdptr 0 STRONGRC_INDEX)
-            store 0 (getelementptr mdptr 0 WEAKRC_INDEX)
+            # all strong references of an atomic value share one weak
+                reference, which is released when the value is dropped
+            store (static-if atomic? 1 else 0) (getelementptr mdptr 0 WEAKRC_INDEX)
             bitcast self this-type
 
         inline __typecall (cls args...)
@@ -117,33 +175,45 @@ typedef+ ReferenceCounted
         if (not (ptrtoint value usize))
             return 0
         let md = (_mdptr value)
-        dupe (load (getelementptr md 0 STRONGRC_INDEX))
+        dupe (rc-load ((typeof value) . Atomic?) (getelementptr md 0 STRONGRC_INDEX))
 
     fn weak-count (value)
         viewing value
         if (not (ptrtoint value usize))
             return 1
         let md = (_mdptr value)
-        dupe (load (getelementptr md 0 WEAKRC_INDEX))
+        let atomic? = ((typeof value) . Atomic?)
+        let rc = (dupe (rc-load atomic? (getelementptr md 0 WEAKRC_INDEX)))
+        static-if atomic?
+            # don't count the weak reference shared by strong references
+            if ((rc-load atomic? (getelementptr md 0 STRONGRC_INDEX)) > 0)
+                sub rc 1
+            else rc
+        else rc
 
 typedef+ Weak
     inline... __typecall
     case (cls, T : type)
-        (gen-type T) . WeakType
+        (gen-type T false) . WeakType
 
     fn _drop (self)
         if (not (ptrtoint (view self) usize))
             return;
         let md = (_mdptr self)
         let refcount = (getelementptr md 0 WEAKRC_INDEX)
-        let rc = (sub (load refcount) 1)
+        let atomic? = ((typeof self) . Atomic?)
+        let rc = (rc-dec atomic? refcount)
         assert (rc >= 0) "corrupt refcount encountered"
-        store rc refcount
         if (rc == 0)
-            let strongrefcount = (getelementptr md 0 STRONGRC_INDEX)
-            if ((load strongrefcount) == 0)
+            static-if atomic?
+                # strong references hold a weak reference until the last one
+                    is gone, so nobody else can still use this value
                 free-rc self
-            # otherwise last strong reference will clean this up
+            else
+                let strongrefcount = (getelementptr md 0 STRONGRC_INDEX)
+                if ((load strongrefcount) == 0)
+                    free-rc self
+                # otherwise last strong reference will clean this up
 
     inline __rimply (T cls)
         static-if (T == Nothing)
@@ -164,8 +234,7 @@ typedef+ Weak
             let md = (_mdptr self)
             let refcount =
                 getelementptr md 0 WEAKRC_INDEX
-            let rc = (add (load refcount) 1)
-            store rc refcount
+            rc-inc ((typeof self) . Atomic?) refcount
         deref (dupe self)
 
     fn upgrade (self)
@@ -174,13 +243,9 @@ typedef+ Weak
             raise (UpgradeError)
         let md = (_mdptr self)
         let refcount = (getelementptr md 0 STRONGRC_INDEX)
-        let rc = (load refcount)
-        assert (rc >= 0) "corrupt refcount encountered"
-        if (rc == 0)
+        if (not (rc-try-acquire ((typeof self) . Atomic?) refcount))
             raise (UpgradeError)
         let RcType = ((typeof self) . RcType)
-        let rc = (add rc 1)
-        store rc refcount
         deref (bitcast (dupe self) RcType)
 
     fn force-upgrade (self)
@@ -188,35 +253,30 @@ typedef+ Weak
         assert (ptrtoint self usize) "upgrading Weak failed"
         let md = (_mdptr self)
         let refcount = (getelementptr md 0 STRONGRC_INDEX)
-        let rc = (load refcount)
-        assert (rc >= 0) "corrupt refcount encountered"
-        assert (rc > 0) "upgrading Weak failed"
+        let acquired? = (rc-try-acquire ((typeof self) . Atomic?) refcount)
+        assert acquired? "upgrading Weak failed"
         let RcType = ((typeof self) . RcType)
-        let rc = (add rc 1)
-        store rc refcount
         deref (bitcast (dupe self) RcType)
 
 typedef+ Rc
     inline... __typecall
     case (cls, T : type)
-        gen-type T
+        gen-type T false
 
     inline new (T args...)
-        (gen-type T) args...
+        (gen-type T false) args...
 
     fn... __copy (value : Rc,)
         viewing value
         let md = (_mdptr value)
         let refcount =
             getelementptr md 0 STRONGRC_INDEX
-        let rc = (load refcount)
-        assert (rc >= 0) "corrupt refcount encountered"
-        let rc = (add rc 1)
-        store rc refcount
+        let rc = (rc-inc ((typeof value) . Atomic?) refcount)
+        assert (rc > 0) "corrupt refcount encountered"
         deref (dupe value)
 
     inline wrap (value)
-        ((gen-type (typeof value)) . wrap) value
+        ((gen-type (typeof value) false) . wrap) value
 
     let _view = view
     inline... view (self : Rc,)
@@ -272,7 +332,8 @@ typedef+ Rc
             otherT as:= type
             static-if (not const?)
                 let WeakT = ('@ selfT 'WeakType)
-                if ((otherT == Weak) or (otherT == (WeakT as type)))
+                if ((otherT == Weak) or (otherT == AtomicWeak)
+                    or (otherT == (WeakT as type)))
                     return WeakT
             let selfT = (('@ selfT 'Type) as type)
             let conv = (f selfT otherT const?)
@@ -289,26 +350,53 @@ typedef+ Rc
         returning void
         let md = (_mdptr self)
         let refcount = (getelementptr md 0 STRONGRC_INDEX)
-        let rc = (sub (load refcount) 1)
-        assert (rc >= 0) "corrupt refcount encountered"
-        if (rc == 0)
-            let payload = (view self)
-            __drop payload
-            # update refcount after drop so weak pointers don't attempt to
-                delete this pointer prematurely
-            store 0 refcount
-            let weakrefcount = (getelementptr md 0 WEAKRC_INDEX)
-            if ((load weakrefcount) == 0)
-                free-rc self
-            # otherwise the last weak reference will free this value
+        let weakrefcount = (getelementptr md 0 WEAKRC_INDEX)
+        static-if ((typeof self) . Atomic?)
+            let rc = (rc-dec true refcount)
+            assert (rc >= 0) "corrupt refcount encountered"
+            if (rc == 0)
+                let payload = (view self)
+                __drop payload
+                # release the weak reference shared by all strong references
+                if ((rc-dec true weakrefcount) == 0)
+                    free-rc self
+                # otherwise the last weak reference will free this value
         else
-            store rc refcount
+            let rc = (sub (load refcount) 1)
+            assert (rc >= 0) "corrupt refcount encountered"
+            if (rc == 0)
+                let payload = (view self)
+                __drop payload
+                # update refcount after drop so weak pointers don't attempt to
+                    delete this pointer prematurely
+                store 0 refcount
+                if ((load weakrefcount) == 0)
+                    free-rc self
+                # otherwise the last weak reference will free this value
+            else
+                store rc refcount
 
     inline __drop (self)
         _drop (deref self)
 
     unlet _view _drop
 
+typedef+ AtomicWeak
+    inline... __typecall
+    case (cls, T : type)
+        (gen-type T true) . WeakType
+
+typedef+ Arc
+    inline... __typecall
+    case (cls, T : type)
+        gen-type T true
+
+    inline new (T args...)
+        (gen-type T true) args...
+
+    inline wrap (value)
+        ((gen-type (typeof value) true) . wrap) value
+
 do
-    let Rc Weak UpgradeError
+    let Rc Weak Arc AtomicWeak UpgradeError
     locals;
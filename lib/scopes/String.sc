@@ -7,7 +7,8 @@
     ======
 
     Provides a string type that manages a mutable byte buffer of varying size
-    on the heap. Strings are guaranteed to be zero-terminated.
+    on the heap. Strings are guaranteed to be zero-terminated. Short strings
+    are stored within the string object itself and don't allocate.
 
 using import struct
 
@@ -21,6 +22,12 @@ let llvm.memcpy.p0i8.p0i8.i64 =
 let llvm.memset.p0i8.i64 =
     extern 'llvm.memset.p0i8.i64
         function void (mutable rawstring) char i64 bool
+let memchr = (extern 'memchr (function voidstar voidstar i32 usize))
+let memcmp = (extern 'memcmp (function i32 voidstar voidstar usize))
+# glibc only; other platforms scan backwards for the first element
+let memrchr =
+    static-if (operating-system == 'linux)
+        extern 'memrchr (function voidstar voidstar i32 usize)
 
 inline string-generator (self)
     Generator
@@ -57,7 +64,8 @@ typedef FixedString < StringBase
 
 """"The supertype and constructor for strings of growing size. New instances
     have a default capacity of 4, and grow by a factor of 2.7 each time their
-    capacity is exceeded.
+    capacity is exceeded. Strings that fit into 16 bytes including their
+    trailing zero are stored inline and don't allocate.
 
     To construct a new growing string type:
 
@@ -84,7 +92,7 @@ fn copy-from-memory (self other count)
     let cls = (typeof self)
     let ZE = cls.ZeroElement
     let olditems = ('internal-reserve self count)
-    let items = self._items
+    let items = ('data self)
     loop (i = 0)
         if (i == count)
             items @ i = ZE
@@ -101,7 +109,7 @@ fn join-from-memory (self other count)
     let start = (countof self)
     let totalcount = (start + count)
     'reserve self totalcount
-    let items = self._items
+    let items = ('data self)
     loop (i j = 0 start)
         if (i == count)
             items @ j = ZE
@@ -116,7 +124,7 @@ fn compare-strings== (self other count)
     let lcount = (countof self)
     if (lcount != count) false
     else
-        let items = self._items
+        let items = ('data self)
         loop (i = 0)
             if (i == count)
                 break true
@@ -131,7 +139,7 @@ inline gen-compare-strings (pred< pred= pred>)
     fn compare-strings (self other count)
         let cls = (typeof self)
         let lcount = (countof self)
-        let items = self._items
+        let items = ('data self)
         loop (i = 0)
             if (i == lcount)
                 if (i == count)
@@ -198,6 +206,158 @@ inline inverted-string-binary-op (f)
             inline (self other)
                 not f self other
 
+fn memory== (a b count)
+    let ET = (elementof (typeof a))
+    (memcmp (bitcast a voidstar) (bitcast b voidstar) (count * (sizeof ET))) == 0
+
+# returns pointer and count of a string, rawstring or single element `value`
+    for the purpose of searching `self`
+inline needle-of (self value)
+    let cls = (typeof self)
+    let ET = cls.ElementType
+    let T = (typeof value)
+    static-if ((unqualified T) < StringBase)
+        static-assert (ET == (unqualified T) . ElementType)
+        _ ('data value) (countof value)
+    elseif ((ET == char) and (((unqualified T) == string) or (&chararray? T)))
+        _ (value as rawstring) (countof value)
+    elseif (((unqualified T) == (pointer ET)) or ((unqualified T) == (mutable pointer ET)))
+        _ value (zero-terminated-length value)
+    else
+        local element = (imply value ET)
+        _ (& element) 1:usize
+
+fn find-memory (self needle count start)
+    let cls = (typeof self)
+    let size = (countof self)
+    let items = ('data self)
+    if ((start > size) or (count > (size - start)))
+        return -1:usize
+    if (count == 0)
+        return start
+    let last = (size - count)
+    static-if ((sizeof cls.ElementType) == 1)
+        # let memchr skip ahead to candidates
+        let first = ((deref (needle @ 0)) as i32)
+        loop (i = start)
+            let p =
+                memchr (bitcast (getelementptr items i) voidstar) first
+                    (last + 1:usize) - i
+            if (p == null)
+                break -1:usize
+            let i = ((ptrtoint p usize) - (ptrtoint items usize))
+            if (memory== (getelementptr items i) needle count)
+                break i
+            i + 1:usize
+    else
+        loop (i = start)
+            if (i > last)
+                break -1:usize
+            if (memory== (getelementptr items i) needle count)
+                break i
+            i + 1:usize
+
+fn rfind-memory (self needle count start)
+    let cls = (typeof self)
+    let size = (countof self)
+    let items = ('data self)
+    if (count > size)
+        return -1:usize
+    let first = (deref (needle @ 0))
+    let start = (min start (size - count))
+    static-if (((sizeof cls.ElementType) == 1) and (not none? memrchr))
+        # let memrchr skip back to candidates
+        loop (n = (start + 1:usize))
+            if (n == 0:usize)
+                break -1:usize
+            let p = (memrchr (bitcast items voidstar) (first as i32) n)
+            if (p == null)
+                break -1:usize
+            let i = ((ptrtoint p usize) - (ptrtoint items usize))
+            if (memory== (getelementptr items i) needle count)
+                break i
+            i
+    else
+        # only compare the remainder where the first element matches
+        loop (i = start)
+            if (((items @ i) == first)
+                and (memory== (getelementptr items i) needle count))
+                break i
+            if (i == 0:usize)
+                break -1:usize
+            i - 1:usize
+
+let SWAR_LO = 0x0101010101010101:u64
+let SWAR_HI = 0x8080808080808080:u64
+# at most this many needles are tested a word at a time
+let SWAR_NEEDLES = 4:usize
+
+# returns the offset of the first 8-byte block at or after start that
+    contains one of the bytes in patterns, or of the partial block at the end
+inline skip-to-candidate-block (items size patterns count start)
+    loop (i = start)
+        if ((i + 8:usize) > size)
+            break i
+        local word = 0:u64
+        llvm.memcpy.p0i8.p0i8.i64
+            bitcast (& word) (mutable rawstring)
+            bitcast (getelementptr items i) rawstring
+            8:i64
+            false
+        let hit? =
+            loop (j = 0:usize)
+                if (j == count)
+                    break false
+                let x = (word ^ (patterns @ j))
+                if ((((x - SWAR_LO) & (~ x)) & SWAR_HI) != 0:u64)
+                    break true
+                j + 1:usize
+        if hit?
+            break i
+        i + 8:usize
+
+fn find-any-memory (self needles count start)
+    let cls = (typeof self)
+    let size = (countof self)
+    let items = ('data self)
+    static-if ((sizeof cls.ElementType) == 1)
+        if (count == 1:usize)
+            return (find-memory self needles 1:usize start)
+        # byte lookup table
+        local table = (nullof (array bool 256))
+        for i in (range count)
+            table @ ((bitcast (deref (needles @ i)) u8) as usize) = true
+        let start =
+            if ((count == 0:usize) or (count > SWAR_NEEDLES)) start
+            else
+                # test 8 bytes at a time for few needles
+                local patterns = (nullof (array u64 4))
+                for i in (range count)
+                    patterns @ i =
+                        ((bitcast (deref (needles @ i)) u8) as u64) * SWAR_LO
+                skip-to-candidate-block items size patterns count (min start size)
+        loop (i = start)
+            if (i >= size)
+                break -1:usize
+            if (table @ ((bitcast (deref (items @ i)) u8) as usize))
+                break i
+            i + 1:usize
+    else
+        loop (i = start)
+            if (i >= size)
+                break -1:usize
+            let c = (deref (items @ i))
+            let hit? =
+                loop (j = 0:usize)
+                    if (j == count)
+                        break false
+                    if (c == (needles @ j))
+                        break true
+                    j + 1:usize
+            if hit?
+                break i
+            i + 1:usize
+
 typedef+ StringBase
 
     """"Implements support for the `as` operator. Strings can be cast to
@@ -207,7 +367,7 @@ typedef+ StringBase
         elseif (T == Collector) string-collector
         elseif ((cls.ElementType == char) and (T == string))
             inline (self)
-                string self._items self._count
+                string ('data self) self._count
 
     inline __ras (T cls)
         static-if ((cls.ElementType == char) and (T == string)) cls
@@ -240,11 +400,11 @@ typedef+ StringBase
     inline __imply (cls T)
         static-match T
         case pointer
-            inline (self) (self._items as cls.PointerType)
+            inline (self) (('data self) as cls.PointerType)
         case voidstar
-            inline (self) (self._items as voidstar)
+            inline (self) (('data self) as voidstar)
         case cls.PointerType
-            inline (self) (self._items as cls.PointerType)
+            inline (self) (('data self) as cls.PointerType)
         default ()
 
     inline __static-rimply (T cls)
@@ -296,21 +456,21 @@ typedef+ StringBase
     fn __@ (self index)
         let index = (index as usize)
         assert (index <= self._count) "index out of bounds"
-        self._items @ index
+        ('data self) @ index
 
     fn __hash (self)
         hash.from-bytes (self as rawstring) (countof self)
 
     fn last (self)
         assert (self._count > 0) "empty string has no last element"
-        self._items @ (self._count - 1:usize)
+        ('data self) @ (self._count - 1:usize)
 
     fn append-slots (self n)
         let idx = (deref self._count)
         let new-count = (idx + n)
         'reserve self new-count
         self._count = new-count
-        self._items @ idx
+        ('data self) @ idx
 
     """"Append `value` as an element to the string `self` and return a reference
         to the new element. When the array is of `GrowingString` type, this
@@ -355,6 +515,18 @@ typedef+ StringBase
         ;
     case using append
 
+    """"Append `count` elements starting at pointer `data` to the string `self`.
+    fn append-many (self data count)
+        let cls = (typeof self)
+        let count = (count as usize)
+        let ptr = (append-slots self count)
+        llvm.memcpy.p0i8.p0i8.i64
+            bitcast (& ptr) (mutable rawstring)
+            bitcast data rawstring
+            (count * (sizeof cls.ElementType)) as i64
+            false
+        ;
+
     """"Construct a new element with arguments `args...` directly in a newly
         assigned slot of string `self`. When the string is of `GrowingString`
         type, this operation will transparently resize the string's storage.
@@ -384,10 +556,10 @@ typedef+ StringBase
             let count = (deref self._count)
             assert (index <= count) "insertion index out of bounds"
             append-slots self 1:usize
-            let items = self._items
+            let items = ('data self)
             for i in (rrange index count)
                 assign (dupe (items @ i)) (items @ (i + 1))
-            let slot = (self._items @ index)
+            let slot = (('data self) @ index)
             assign value slot
             slot
         inline... insert
@@ -402,8 +574,8 @@ typedef+ StringBase
         assert (&count > 0) "can't pop from empty string"
         &count -= 1
         let idx = (deref &count)
-        let result = (dupe (deref (self._items @ idx)))
-        store ((typeof self) . ZeroElement) (getelementptr self._items idx)
+        let result = (dupe (deref (('data self) @ idx)))
+        store ((typeof self) . ZeroElement) (getelementptr ('data self) idx)
         result
 
     """"Remove element at index from string `self` and return it.
@@ -412,12 +584,12 @@ typedef+ StringBase
         let &count = self._count
         assert (index < &count) "can't pop from empty string"
         &count -= 1
-        let items = self._items
+        let items = ('data self)
         let result =
             dupe (deref (items @ index))
         for i in (range index &count)
             assign (dupe (items @ (i + 1))) (items @ i)
-        store ((typeof self) . ZeroElement) (getelementptr self._items &count)
+        store ((typeof self) . ZeroElement) (getelementptr ('data self) &count)
         result
 
     """"Clear the string and reset its element count to zero. This will drop
@@ -428,7 +600,7 @@ typedef+ StringBase
         self._count = 0:usize
         # null remainder of memory
         llvm.memset.p0i8.i64
-            bitcast self._items (mutable rawstring)
+            bitcast ('data self) (mutable rawstring)
             0:char
             (offset * (sizeof cls.ElementType)) as i64
             false
@@ -448,7 +620,7 @@ typedef+ StringBase
             self._count = count
             # null remainder of memory
             llvm.memset.p0i8.i64
-                bitcast (getelementptr self._items count) (mutable rawstring)
+                bitcast (getelementptr ('data self) count) (mutable rawstring)
                 0:char
                 (offset * (sizeof cls.ElementType)) as i64
                 false
@@ -463,7 +635,7 @@ typedef+ StringBase
 
     """"Safely swap the contents of two indices.
     fn swap (self a b)
-        swap (self._items @ a) (self._items @ b)
+        swap (('data self) @ a) (('data self) @ b)
 
     """"Implements support for the `copy` operation.
     fn __copy (self)
@@ -489,6 +661,79 @@ typedef+ StringBase
         assign new-items newarr._items
         newarr
 
+    """"Returns the index of the first occurrence of `value` in string `self`
+        at or after index `start`, or `-1:usize` if there is none. `value` can
+        be a single element or a string of the same element type.
+    inline find (self value start)
+        let needle count = (needle-of self value)
+        find-memory self needle count
+            static-if (none? start) 0:usize
+            else (start as usize)
+
+    """"Returns the index of the last occurrence of `value` in string `self`
+        that begins at or before index `start`, or `-1:usize` if there is none.
+    inline rfind (self value start)
+        let needle count = (needle-of self value)
+        rfind-memory self needle count
+            static-if (none? start) -1:usize
+            else (start as usize)
+
+    """"Returns the index of the first element of string `self` at or after
+        index `start` that is contained in string `values`, or `-1:usize` if
+        there is none.
+    inline find-any (self values start)
+        let needles count = (needle-of self values)
+        find-any-memory self needles count
+            static-if (none? start) 0:usize
+            else (start as usize)
+
+    """"Returns the number of non-overlapping occurrences of `value` in string
+        `self`.
+    fn count (self value)
+        let needle count = (needle-of self value)
+        assert (count > 0) "can't count empty string"
+        loop (i n = 0:usize 0:usize)
+            let i = (find-memory self needle count i)
+            if (i == -1:usize)
+                break n
+            _ (i + count) (n + 1:usize)
+
+    """"Returns `true` if string `self` begins with `value`.
+    inline starts-with? (self value)
+        let needle count = (needle-of self value)
+        and
+            count <= (countof self)
+            memory== ('data self) needle count
+
+    """"Returns `true` if string `self` ends with `value`.
+    inline ends-with? (self value)
+        let needle count = (needle-of self value)
+        let size = (countof self)
+        and
+            count <= size
+            memory== (getelementptr ('data self) (size - count)) needle count
+
+    """"Returns a generator that yields the parts of string `self` separated by
+        `separator` as new growing strings. Adjacent separators produce empty
+        parts.
+    inline split (self separator)
+        let needle count = (needle-of self separator)
+        assert (count > 0) "empty separator"
+        let PartType = (GrowingString (typeof self) . ElementType)
+        let size = (countof self)
+        inline next-end (start)
+            let i = (find-memory self needle count start)
+            ? (i == -1:usize) size i
+        Generator
+            inline () (_ 0:usize (next-end 0:usize))
+            inline (start end) (start <= size)
+            inline (start end)
+                PartType (getelementptr ('data self) start) (end - start)
+            inline (start end)
+                let start = (end + count)
+                _ start
+                    ? (start > size) start (next-end start)
+
     unlet append-slots
 
 typedef+ FixedString
@@ -529,11 +774,15 @@ typedef+ FixedString
                 _items = items
                 _count = 0:usize
 
+    """"Returns a pointer to the elements of string `self`.
+    inline data (self)
+        deref self._items
+
     """"Implements support for the `repr` operation.
     fn __repr (self)
         let cls = (typeof self)
         if (cls.ElementType == char)
-            string self._items self._count
+            string ('data self) self._count
         else
             ..
                 "[count="
@@ -559,6 +808,18 @@ typedef+ FixedString
 
 
 let DEFAULT_CAPACITY = (1:usize << 2:usize)
+# bytes of a `GrowingString` that hold short strings without allocating
+let INLINE_BYTES = 16:usize
+let InlineStorage = (array usize (INLINE_BYTES // (sizeof usize)))
+
+# references are passed through; other values are copied to the stack so that
+    the address of their contents can be taken
+inline addressable (value)
+    static-if (&? value) value
+    else
+        let ptr = (alloca (typeof value))
+        store (dupe value) ptr
+        ptrtoref ptr
 
 typedef+ GrowingString
     let parent-type = this-type
@@ -567,50 +828,73 @@ typedef+ GrowingString
     inline gen-growing-string-type (element-type)
         static-assert ((typeof element-type) == type)
         let parent-type = this-type
+        let inline-capacity = (INLINE_BYTES // (sizeof element-type))
         struct
             .. "<GrowingString "
                 tostring element-type
                 ">"
             \ < parent-type
-            _items : (mutable pointer element-type)
             _count : usize
+            # capacity including the trailing zero; strings with a capacity of
+                InlineCapacity or less are stored in `_storage`, otherwise
+                `_storage` holds a pointer to the heap
             _capacity : usize
+            _storage : InlineStorage
 
             let
                 ElementType = element-type
                 PointerType = (pointer element-type)
                 ZeroElement = (nullof element-type)
+                # without room for at least one element and the trailing zero,
+                    all strings live on the heap
+                InlineCapacity =
+                    static-if (inline-capacity < 2:usize) 0:usize
+                    else inline-capacity
 
     fn nearest-capacity (capacity count)
-        loop (new-capacity = capacity)
+        loop (new-capacity = (max capacity DEFAULT_CAPACITY))
             if (new-capacity < count)
                 repeat (new-capacity * 27:usize // 10:usize)
             break new-capacity
 
+    inline heap? (self)
+        self._capacity > (typeof self) . InlineCapacity
+
     @@ memo
     inline from-arguments (cls)
         from cls let PointerType
 
-        inline from-rawstring (data count)
-            let capacity =
-                nearest-capacity DEFAULT_CAPACITY (count + 1)
+        inline empty-string ()
+            Struct.__typecall cls
+                _count = 0:usize
+                _capacity = cls.InlineCapacity
+                _storage = (nullof InlineStorage)
+
+        inline from-heap (capacity)
             let ET = cls.ElementType
             let items = (malloc-array ET capacity)
+            llvm.memset.p0i8.i64
+                bitcast items (mutable rawstring)
+                0:char
+                (capacity * (sizeof ET)) as i64
+                false
+            local self = (empty-string)
+            self._capacity = capacity
+            (self._storage @ 0) = (ptrtoint items usize)
+            deref self
+
+        inline from-rawstring (data count)
+            local self =
+                if ((count + 1) <= cls.InlineCapacity) (empty-string)
+                else
+                    from-heap (nearest-capacity DEFAULT_CAPACITY (count + 1))
             llvm.memcpy.p0i8.p0i8.i64
-                bitcast (view items) (mutable rawstring)
+                bitcast ('data self) (mutable rawstring)
                 bitcast data rawstring
                 (count * (sizeof cls.ElementType)) as i64
                 false
-            # null remainder of memory
-            llvm.memset.p0i8.i64
-                bitcast (getelementptr (view items) count) (mutable rawstring)
-                0:char
-                ((capacity - count) * (sizeof ET)) as i64
-                false
-            Struct.__typecall cls
-                _items = items
-                _count = count
-                _capacity = capacity
+            self._count = count
+            deref self
 
         inline... string-constructor
         case (data : PointerType, count : usize)
@@ -618,19 +902,9 @@ typedef+ GrowingString
         #case (data : PointerType,)
             this-function data (zero-terminated-length data)
         case (capacity : usize = DEFAULT_CAPACITY,)
-            let capacity =
-                nearest-capacity DEFAULT_CAPACITY (capacity + 1)
-            let ET = cls.ElementType
-            let items = (malloc-array ET capacity)
-            llvm.memset.p0i8.i64
-                bitcast items (mutable rawstring)
-                0:char
-                (capacity * (sizeof ET)) as i64
-                false
-            Struct.__typecall cls
-                _items = items
-                _count = 0:usize
-                _capacity = capacity
+            if ((capacity + 1) <= cls.InlineCapacity) (empty-string)
+            else
+                from-heap (nearest-capacity DEFAULT_CAPACITY (capacity + 1))
         case (s : &chararray, ...)
             local self = (from-rawstring (s as rawstring) (countof s))
             va-map
@@ -661,11 +935,22 @@ typedef+ GrowingString
 
     unlet from-arguments
 
+    """"Returns a pointer to the elements of string `self`. Short strings are
+        stored within `self`, so the pointer is only valid for as long as
+        `self` is neither moved nor resized.
+    inline data (self)
+        let cls = (typeof self)
+        let self = (addressable self)
+        if (heap? self)
+            inttoptr (deref (self._storage @ 0)) (mutable pointer cls.ElementType)
+        else
+            bitcast (& self._storage) (mutable pointer cls.ElementType)
+
     """"Implements support for the `repr` operation.
     fn __repr (self)
         let cls = (typeof self)
         if (cls.ElementType == char)
-            string self._items self._count
+            string ('data self) self._count
         else
             ..
                 "[count="
@@ -673,7 +958,7 @@ typedef+ GrowingString
                 " capacity="
                 repr self._capacity
                 " items="
-                repr self._items
+                repr ('data self)
                 "]"
 
     """"Returns the current maximum capacity of string `self`, which includes
@@ -692,7 +977,8 @@ typedef+ GrowingString
                 nearest-capacity (deref self._capacity) (count + 1)
             let T = (typeof self)
             let count = (deref self._count)
-            let old-items = (deref self._items)
+            let was-heap? = (heap? self)
+            let old-items = ('data self)
             let new-items = (malloc-array T.ElementType new-capacity)
             llvm.memcpy.p0i8.p0i8.i64
                 bitcast (view new-items) (mutable rawstring)
@@ -705,13 +991,38 @@ typedef+ GrowingString
                 0:char
                 ((new-capacity - count) * (sizeof T.ElementType)) as i64
                 false
-            assign new-items self._items
+            (self._storage @ 0) = (ptrtoint new-items usize)
             self._capacity = new-capacity
-            dupe old-items
+            # inline storage has nothing to free
+            if was-heap? old-items
+            else (nullof (typeof old-items))
         else
-            nullof (typeof self._items)
+            nullof (mutable pointer cls.ElementType)
+
+    """"Implements support for the `copy` operation.
+    fn __copy (self)
+        viewing self
+        let cls = (typeof self)
+        local newstr = (dupe (deref self))
+        if (heap? self)
+            let capacity = (deref self._capacity)
+            let new-items = (malloc-array cls.ElementType capacity)
+            llvm.memcpy.p0i8.p0i8.i64
+                bitcast (view new-items) (mutable rawstring)
+                bitcast ('data self) rawstring
+                (capacity * (sizeof cls.ElementType)) as i64
+                false
+            (newstr._storage @ 0) = (ptrtoint new-items usize)
+        newstr
+
+    """"Implements support for freeing the string's memory when it goes out
+        of scope.
+    inline __drop (self)
+        if (heap? self)
+            free (inttoptr (deref (self._storage @ 0))
+                (mutable pointer ((typeof self) . ElementType)))
 
-    unlet gen-growing-string-type parent-type nearest-capacity
+    unlet gen-growing-string-type parent-type nearest-capacity heap?
 
 let String = (GrowingString char)
 
@@ -342,6 +342,9 @@ case (global-scope, show-logo : bool = false, history-path : string = "")
                     let f = (sc_compile (sc_typify_template expr 0 null) 0:u64)
                     let fptr = (f as (pointer (raises (function void) Error)))
                     fptr;
+                    # nothing refers to the printer afterwards
+                    sc_compile_release f
+                    sc_compile_collect;
                     _ counter eval-scope
                 else
                     let tmp = (Symbol "#result...")
@@ -3509,6 +3509,20 @@ let modules = (sc_global_new 'modules Scope 0:u32 'Private)
 sc_global_set_initializer modules `[(Scope)]
 let modules = `(ptrtoref modules)
 
+# the import graph: `module-imports` maps the path of each loaded module to a
+    list of the module paths it imported directly, `module-sources` maps it to
+    a list of name, environment and file stamp so it can be reloaded,
+    and `module-load-stack` holds the paths of the modules presently loading.
+let module-imports = (sc_global_new 'module-imports Scope 0:u32 'Private)
+sc_global_set_initializer module-imports `[(Scope)]
+let module-imports = `(ptrtoref module-imports)
+let module-sources = (sc_global_new 'module-sources Scope 0:u32 'Private)
+sc_global_set_initializer module-sources `[(Scope)]
+let module-sources = `(ptrtoref module-sources)
+let module-load-stack = (sc_global_new 'module-load-stack list 0:u32 'Private)
+sc_global_set_initializer module-load-stack `['()]
+let module-load-stack = `(ptrtoref module-load-stack)
+
 """"`__env` is a special symbol table of type `Scope` describing the module
     environment. `import`, `include` and `shared-library` depend on its
     contents. Modules imported with `import` inherit the environment presently
@@ -4304,12 +4318,16 @@ fn exec-module (expr eval-scope)
             do
                 hide-traceback;
                 sc_compile wrapf compile-flag-module
+        # batched code must not fail to emit once it is called
+        sc_compile_flush;
         if (('typeof f) == StageFunctionType)
             let fptr = (f as StageFunctionType)
             let result =
                 do
                     hide-traceback;
                     fptr;
+            # nothing calls the stage again; it is unloaded by a later collection
+            sc_compile_release f
             let result = (bitcast result Value)
             repeat result ('anchor result)
         else
@@ -4350,14 +4368,19 @@ fn dots-to-slashes (pattern)
 fn load-module (module-name module-path env opts...)
     let command = (va-option command opts...)
     let command? = (not (none? command))
-    if ((not command?) and (not (sc_is_file module-path)))
+    # pipes and terminals are parsed from memory and resolve imports
+        relative to the working directory
+    let stream? = ((not command?) and (sc_is_stream module-path))
+    if ((not command?) and (not stream?) and (not (sc_is_file module-path)))
         hide-traceback;
         error
             .. "no such module: " module-path
     let module-path =
-        if command? module-path
+        if (command? or stream?) module-path
         else (sc_realpath module-path)
-    let module-dir = (sc_dirname module-path)
+    let module-dir =
+        if stream? (working-dir as string)
+        else (sc_dirname module-path)
     let module-dir =
         if command? (sc_realpath module-dir)
         else module-dir
@@ -4380,11 +4403,18 @@ fn load-module (module-name module-path env opts...)
             module-path = module-path
             module-dir = module-dir
             module-name = module-name
+    # imports show up as nested sections of the time report
+    sc_time_section_begin
+        if command? str"command"
+        else module-path
     try
         hide-traceback;
-        exec-module expr (Scope eval-scope)
+        let result = (exec-module expr (Scope eval-scope))
+        sc_time_section_end;
+        result
     except (err)
         hide-traceback;
+        sc_time_section_end;
         error@+ err unknown-anchor
             if command? str"while executing command"
             else
@@ -4430,6 +4460,72 @@ fn find-module-path (base-dir name env)
             repeat patterns
         return module-path
 
+fn symbol-in-list? (l sym)
+    loop (l = l)
+        if (empty? l)
+            break false
+        let at l = (decons l)
+        if ((at as Symbol) == sym)
+            break true
+        l
+
+fn record-module-import (module-path-sym)
+    # the module that is presently loading imports `module-path-sym`
+    let stack = (deref module-load-stack)
+    if (empty? stack)
+        return;
+    let importer = (('@ stack) as Symbol)
+    let imports = (deref module-imports)
+    let deps =
+        try (('@ imports importer) as list)
+        except (err) '()
+    if (not (symbol-in-list? deps module-path-sym))
+        module-imports =
+            'bind imports importer (cons module-path-sym deps)
+
+fn require-path (name module-path env)
+    let module-path-sym = (Symbol module-path)
+    fn get-modules () (deref modules)
+    fn set-modules-path (symbol value)
+        modules =
+            'bind (get-modules) symbol value
+    let content =
+        try ('@ (get-modules) module-path-sym)
+        except (err)
+            set-modules-path module-path-sym incomplete
+            # imports are recorded anew on every load
+            module-imports = ('unbind (deref module-imports) module-path-sym)
+            module-sources =
+                'bind (deref module-sources) module-path-sym
+                    list (name as string) env (sc_file_stamp module-path)
+            let stack = (deref module-load-stack)
+            module-load-stack = (cons module-path-sym stack)
+            let content =
+                try
+                    hide-traceback;
+                    load-module (name as string) module-path env
+                except (err)
+                    # allow the import to be retried once the error is fixed
+                    module-load-stack = stack
+                    modules = ('unbind (get-modules) module-path-sym)
+                    hide-traceback;
+                    raise err
+            module-load-stack = stack
+            set-modules-path module-path-sym content
+            record-module-import module-path-sym
+            # unload the stages of a top level import and everything it
+                imported, once
+            if (empty? stack)
+                sc_compile_collect;
+            return content
+    if (('typeof content) == type)
+        if (content == incomplete)
+            error
+                .. "trying to import module " (repr name)
+                    " while it is being imported"
+    record-module-import module-path-sym
+    content
+
 fn require-from (base-dir name env)
     #assert-typeof name Symbol
     let namestr = (dots-to-slashes (name as string))
@@ -4453,30 +4549,115 @@ fn require-from (base-dir name env)
         let module-path = (sc_realpath (make-module-path pattern namestr))
         if (empty? module-path)
             repeat patterns
-        let module-path-sym = (Symbol module-path)
-        fn get-modules () (deref modules)
-        fn get-modules-path (symbol) ('@ (get-modules) symbol)
-        fn set-modules-path (symbol value)
-            modules =
-                'bind (get-modules) symbol value
-        let content =
-            try (get-modules-path module-path-sym)
+        if (not (sc_is_file module-path))
+            # a module that has been loaded before remains importable
+            try ('@ (deref modules) (Symbol module-path))
             except (err)
-                if (not (sc_is_file module-path))
-                    repeat patterns
-                set-modules-path module-path-sym incomplete
-                let content =
-                    do
-                        hide-traceback;
-                        load-module (name as string) module-path env
-                set-modules-path module-path-sym content
-                return content
-        if (('typeof content) == type)
-            if (content == incomplete)
-                error
-                    .. "trying to import module " (repr name)
-                        " while it is being imported"
-        return content
+                repeat patterns
+        hide-traceback;
+        return (require-path name module-path env)
+
+fn module-dependencies (module-path)
+    """"Returns a list of the paths of all modules that the module at
+        `module-path` imported directly while loading.
+    try (('@ (deref module-imports) (Symbol module-path)) as list)
+    except (err) '()
+
+fn module-dependents (module-path)
+    """"Returns a list of the paths of all loaded modules that imported the
+        module at `module-path` directly while loading.
+    let module-path-sym = (Symbol module-path)
+    let imports = (deref module-imports)
+    loop (last-index result = -1 '())
+        let key value index = ('next imports last-index)
+        if (index < 0)
+            break result
+        if (symbol-in-list? (value as list) module-path-sym)
+            repeat index (cons key result)
+        repeat index result
+
+fn reload-modules ()
+    """"Checks the source files of all loaded modules for changes, then
+        invalidates every changed module along with all the modules that
+        depend on it, directly or indirectly, and loads them again. Modules
+        that did not change and do not depend on a changed module are kept.
+
+        Returns a list of the paths of all reloaded modules. Scopes that bound
+        the contents of a reloaded module must import it again to see the new
+        contents. Modules that are presently loading are never reloaded.
+
+        If any of the modules fails to load, all modules, including those that
+        were already reloaded, are restored to their previous versions and the
+        error is raised.
+    let sources = (deref module-sources)
+    # modules that are still loading can not be reloaded
+    let loading = (deref module-load-stack)
+    let stale =
+        loop (last-index stale = -1 '())
+            let key value index = ('next sources last-index)
+            if (index < 0)
+                break stale
+            if (symbol-in-list? loading (key as Symbol))
+                repeat index stale
+            let module-path = ((key as Symbol) as string)
+            let name env stamp = (decons (value as list) 3)
+            if ((sc_file_stamp module-path) != (stamp as u64))
+                repeat index (cons key stale)
+            repeat index stale
+    if (empty? stale)
+        return stale
+    # propagate invalidation to all dependents
+    let imports = (deref module-imports)
+    let stale =
+        loop (stale = stale)
+            let stale changed? =
+                loop (last-index stale changed? = -1 stale false)
+                    let key value index = ('next imports last-index)
+                    if (index < 0)
+                        break stale changed?
+                    let key = (key as Symbol)
+                    if ((symbol-in-list? stale key) or (symbol-in-list? loading key))
+                        repeat index stale changed?
+                    let depends? =
+                        loop (deps = (value as list))
+                            if (empty? deps)
+                                break false
+                            let dep deps = (decons deps)
+                            if (symbol-in-list? stale (dep as Symbol))
+                                break true
+                            deps
+                    if depends?
+                        repeat index (cons key stale) true
+                    repeat index stale changed?
+            if (not changed?)
+                break stale
+            stale
+    let old-modules = (deref modules)
+    loop (l = stale)
+        if (empty? l)
+            break;
+        let key l = (decons l)
+        let key = (key as Symbol)
+        modules = ('unbind (deref modules) key)
+        l
+    try
+        loop (l = stale)
+            if (empty? l)
+                break;
+            let key l = (decons l)
+            let module-path = ((key as Symbol) as string)
+            let name env = (decons (('@ sources key) as list) 2)
+            hide-traceback;
+            require-path (name as string) module-path (env as Scope)
+            l
+    except (err)
+        # typically a syntax error in the file that was just edited
+        modules = old-modules
+        module-imports = imports
+        module-sources = sources
+        hide-traceback;
+        raise err
+    stale
 
 let import =
     sugar-scope-macro
@@ -5008,10 +5189,15 @@ let parse-compile-flags =
                         \ " " (repr 'dump-function)
                         \ " " (repr 'dump-time)
                         \ " " (repr 'no-debug-info)
+                        \ " " (repr 'full-debug-info)
                         \ " " (repr 'O0)
                         \ " " (repr 'O1)
                         \ " " (repr 'O2)
                         \ " " (repr 'O3)
+                        \ " " (repr 'profile-generate)
+                        \ " " (repr 'profile-use)
+                        \ " " (repr 'parallel)
+                        \ " " (repr 'thin-lto)
             let argc = ('argcount args)
             loop (i flags = 0 0:u64)
                 if (i == argc)
@@ -5025,10 +5211,15 @@ let parse-compile-flags =
                     case 'dump-function compile-flag-dump-function
                     case 'dump-time compile-flag-dump-time
                     case 'no-debug-info compile-flag-no-debug-info
+                    case 'full-debug-info compile-flag-full-debug-info
                     case 'O0 compile-flag-O0
                     case 'O1 compile-flag-O1
                     case 'O2 compile-flag-O2
                     case 'O3 compile-flag-O3
+                    case 'profile-generate compile-flag-profile-generate
+                    case 'profile-use compile-flag-profile-use
+                    case 'parallel compile-flag-parallel
+                    case 'thin-lto compile-flag-thin-lto
                     default (flag-error flag)
                 _ (i + 1) (flags | flag)
 
@@ -5048,6 +5239,9 @@ spice-quote
     inline compile-object-to-buffer (target file-kind module-name table flags...)
         sc_compile_object_to_buffer target file-kind module-name table (parse-compile-flags flags...)
 
+    inline thin-lto-link (target path inputs flags...)
+        sc_thin_lto_link target inputs path (parse-compile-flags flags...)
+
 inline convert-assert-args (args cond msg)
     if ((countof args) == 2) msg
     else
@@ -8986,6 +9180,8 @@ sugar static-shared-library (name...)
 unlet _memo dot-char dot-sym ellipsis-symbol _Value constructor destructor
     \ gen-tupleof nested-struct-field-accessor nested-union-field-accessor
     \ tuple-comparison gen-arrayof MethodsAccessor-typeattr floorf modules
+    \ module-imports module-sources module-load-stack symbol-in-list?
+    \ record-module-import require-path
     \ string-array-ref-type? llvm.memcpy.p0i8.p0i8.i64 cenum-gen-repr-funcs
 
 run-stage; # 12
@@ -9044,6 +9240,8 @@ fn print-help (exename)
             -v, --version           print runtime version and exit.
             -e, --env               run program from project environment.
             -s, --signal-abort      raise SIGABRT when calling `abort!`.
+            --time-report[=json]    print time and memory spent per phase,
+                                    module and LLVM pass at exit.
             -c command              program passed in as string (terminates option list)
             -m module               run module on path (terminates option list)
             filename                program read from scopes file.
@@ -9103,6 +9301,9 @@ fn run-main ()
                     print-version;
                 elseif ((== arg "--signal-abort") or (== arg "-s"))
                     set-signal-abort! true
+                elseif ((== arg "--time-report") or (== arg "--time-report=json"))
+                    # enabled by the runtime before the core was loaded
+                    _;
                 elseif ((== arg "--env") or (== arg "-e"))
                     project? = true
                 elseif (== arg "-c")
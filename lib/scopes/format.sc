@@ -9,7 +9,8 @@ using import String
 """"format
     ======
 
-    Support for agnostic string formatting through `format`.
+    Support for agnostic string formatting through `format`, and for
+    formatting without allocations through `format-into`.
 
     See the following examples:
 
@@ -32,6 +33,10 @@ using import String
                 name = "Joana"
                 age = 42
 
+        # writes "x = 1.5, n = -42" into a stack buffer
+        local buf : (array i8 64)
+        format-into buf "x = {}, n = {}" 1.5 -42
+
 #-------------------------------------------------------------------------------
 # hex/oct/bin conversion
 #-------------------------------------------------------------------------------
@@ -86,7 +91,240 @@ fn string-array-ref-type? (T)
             ptrcmp== ('element@ T 0) i8
     else false
 
-spice format (str args...)
+#-------------------------------------------------------------------------------
+# direct writes
+#-------------------------------------------------------------------------------
+
+let STREAM_BUFFER_SIZE = 4096:usize
+
+vvv bind C
+include
+    """"#include <stdio.h>
+        #include <stdlib.h>
+        #include <string.h>
+        #ifdef _WIN32
+        #include <io.h>
+        #define __scopes_write _write
+        #else
+        #include <unistd.h>
+        #define __scopes_write write
+        #endif
+
+        static int __scopes_finish_real(char *buf, int n) {
+            /* mark integral values as reals, like repr does */
+            if (strpbrk(buf, ".eEni") == NULL) {
+                buf[n++] = '.';
+                buf[n++] = '0';
+                buf[n] = 0;
+            }
+            return n;
+        }
+
+        /* shortest decimal representation that reads back as the same value;
+           a precision that round-trips implies that every higher precision
+           round-trips as well, so the search can bisect */
+        int __scopes_format_f64(char *buf, double value) {
+            int lo = 1, hi = 17;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                snprintf(buf, 32, "%.*g", mid, value);
+                if (strtod(buf, NULL) == value) hi = mid; else lo = mid + 1;
+            }
+            return __scopes_finish_real(buf, snprintf(buf, 32, "%.*g", lo, value));
+        }
+
+        int __scopes_format_f32(char *buf, float value) {
+            int lo = 1, hi = 9;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                snprintf(buf, 32, "%.*g", mid, (double)value);
+                if (strtof(buf, NULL) == value) hi = mid; else lo = mid + 1;
+            }
+            return __scopes_finish_real(buf,
+                snprintf(buf, 32, "%.*g", lo, (double)value));
+        }
+
+        void __scopes_stream_write(void *file, int fd, const char *data, size_t count) {
+            if (file) {
+                fwrite(data, 1, count, (FILE *)file);
+            } else {
+                while (count > 0) {
+                    long written = (long)__scopes_write(fd, data, (unsigned)count);
+                    if (written <= 0) break;
+                    data += written;
+                    count -= (size_t)written;
+                }
+            }
+        }
+
+# pairs of decimal digits from 00 to 99
+let DIGIT_PAIRS =
+    .. "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        \ "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        \ "8081828384858687888990919293949596979899"
+
+""""A formatting target that writes into a caller supplied buffer of fixed
+    size, truncating the output and always terminating it with a zero.
+struct BufferWriter plain
+    data : (mutable rawstring)
+    capacity : usize
+    count : usize = 0:usize
+
+    inline... __typecall
+    case (cls, data : (mutable rawstring), capacity : usize)
+        Struct.__typecall cls data capacity
+    case (cls, data : (mutable rawstring), capacity : integer)
+        Struct.__typecall cls data (capacity as usize)
+
+    fn write-bytes (self data count)
+        let capacity = (deref self.capacity)
+        let offset = (deref self.count)
+        # one byte is reserved for the terminating zero
+        if ((offset + 1:usize) < capacity)
+            let n = (min count (capacity - offset - 1:usize))
+            C.extern.memcpy
+                bitcast (getelementptr (deref self.data) offset) voidstar
+                bitcast data voidstar
+                n
+        self.count = offset + count
+        count
+
+    """"Terminates the output and returns the number of bytes that the complete
+        output requires, excluding the terminating zero.
+    fn finish (self)
+        let capacity = (deref self.capacity)
+        if (capacity > 0:usize)
+            let end = (min (deref self.count) (capacity - 1:usize))
+            store 0:i8 (getelementptr (deref self.data) end)
+        deref self.count
+
+""""A buffered formatting target for a C `FILE` pointer or a file descriptor.
+    Buffered output is written when the buffer is full, when `flush` is
+    called and when the stream is dropped.
+struct Stream
+    file : voidstar
+    fd : i32
+    count : usize
+    buffer : (array i8 STREAM_BUFFER_SIZE)
+
+    inline... __typecall
+    case (cls, fd : i32)
+        Struct.__typecall cls
+            file = null
+            fd = fd
+            count = 0:usize
+            buffer = (nullof (array i8 STREAM_BUFFER_SIZE))
+    case (cls, file : pointer)
+        Struct.__typecall cls
+            file = (bitcast file voidstar)
+            fd = -1
+            count = 0:usize
+            buffer = (nullof (array i8 STREAM_BUFFER_SIZE))
+
+    """"Writes all buffered output.
+    fn flush (self)
+        if (self.count > 0:usize)
+            C.extern.__scopes_stream_write (deref self.file) (deref self.fd)
+                & (self.buffer @ 0)
+                deref self.count
+            self.count = 0:usize
+        ;
+
+    fn write-bytes (self data count)
+        if ((self.count + count) > STREAM_BUFFER_SIZE)
+            flush self
+        if (count >= STREAM_BUFFER_SIZE)
+            # too large to be buffered
+            C.extern.__scopes_stream_write (deref self.file) (deref self.fd)
+                bitcast data rawstring
+                count
+        else
+            C.extern.memcpy
+                bitcast (& (self.buffer @ self.count)) voidstar
+                bitcast data voidstar
+                count
+            self.count += count
+        count
+
+    inline __drop (self)
+        flush self
+
+inline write-bytes (sink data count)
+    static-if ((unqualified (typeof sink)) == String)
+        'append-many sink data count
+        count
+    else
+        'write-bytes sink data count
+
+fn write-integer (sink value)
+    let T = (typeof value)
+    let N = 24
+    local digits : (array i8 N)
+    let neg? =
+        static-if (signed? T) (value < (0 as T))
+        else false
+    # the magnitude of the most negative value only fits into a u64
+    let n =
+        static-if (signed? T)
+            let v = ((value as i64) as u64)
+            ? neg? (0:u64 - v) v
+        else (value as u64)
+    let i =
+        loop (i n = N n)
+            if (n >= 10:u64)
+                let pair = (((n % 100:u64) * 2:u64) as usize)
+                digits @ (i - 1) = (DIGIT_PAIRS @ (pair + 1:usize))
+                digits @ (i - 2) = (DIGIT_PAIRS @ pair)
+                let n = (n // 100:u64)
+                if (n == 0:u64)
+                    break (i - 2)
+                repeat (i - 2) n
+            digits @ (i - 1) = ((n as i8) + 48:i8)
+            break (i - 1)
+    let i =
+        if neg?
+            digits @ (i - 1) = 45:i8
+            i - 1
+        else i
+    write-bytes sink (& (digits @ i)) ((N - i) as usize)
+
+fn write-real (sink value)
+    local digits : (array i8 32)
+    let count =
+        static-if ((typeof value) == f32)
+            C.extern.__scopes_format_f32 (& (digits @ 0)) value
+        else
+            C.extern.__scopes_format_f64 (& (digits @ 0)) (value as f64)
+    write-bytes sink (& (digits @ 0)) (count as usize)
+
+# returns an expression that writes `value` to `sink` and evaluates to the
+    number of bytes written
+fn write-value (sink value)
+    let QT = ('qualified-typeof value)
+    let T = ('strip-qualifiers QT)
+    if (T == string)
+        `(write-bytes sink (value as rawstring) (countof value))
+    elseif (string-array-ref-type? QT)
+        # the array is a buffer; the string ends at the first zero
+        `(write-bytes sink (value as rawstring)
+            (C.extern.strnlen (value as rawstring) (countof value)))
+    elseif (T == String)
+        `(write-bytes sink (& (value @ 0)) (countof value))
+    elseif (T == bool)
+        `(? value (write-bytes sink ("true" as rawstring) 4:usize)
+            (write-bytes sink ("false" as rawstring) 5:usize))
+    elseif (T < integer)
+        `(write-integer sink value)
+    elseif (T < real)
+        `(write-real sink value)
+    else
+        `(do
+            let s = (tostring value)
+            write-bytes sink (s as rawstring) (countof s))
+
+# parses the format string `str` into a sequence of literal strings and
+    arguments, passing each argument through `convert`
+inline parse-format (convert str args...)
     using import UTF-8
 
     anchor := ('anchor str)
@@ -151,11 +389,7 @@ spice format (str args...)
                     else
                         parse-error (start + k + 1)
                             "invalid character in index expression"
-            QT := ('qualifiersof body)
-            T := ('strip-qualifiers QT)
-            'append block
-                if ((T == String) | (T == string) | (string-array-ref-type? QT)) body
-                else `(tostring body)
+            'append block (convert body)
             _ (i + 1) nextarg
         else
             # read string chunk up to the next variable and append to result,
@@ -178,9 +412,48 @@ spice format (str args...)
                 repeat (k + 1)
             'append block (substr as string)
             _ i nextarg
+    block
+
+spice format (str args...)
+    let block =
+        parse-format
+            inline (body)
+                QT := ('qualifiersof body)
+                T := ('strip-qualifiers QT)
+                if ((T == String) | (T == string) | (string-array-ref-type? QT)) body
+                else `(tostring body)
+            str
+            args...
     sc_argument_list_new ((countof block) as i32) (& (block @ 0))
 
+""""Formats `args...` according to the format string `str`, which uses the
+    same syntax as `format`, and writes the result to `sink` without
+    allocating memory. The format string is translated into a sequence of
+    writes at compile time. Returns the number of bytes written.
+
+    `sink` can be a `String`, a `Stream` or `BufferWriter`, or a reference to
+    an array of characters, which is then zero-terminated like a
+    `BufferWriter`. Integers, reals, booleans and strings are written
+    directly; other values are converted with `tostring`.
+spice format-into (sink str args...)
+    let block =
+        parse-format
+            inline (body) body
+            str
+            args...
+    inline sum-writes (sink)
+        fold (total = `0:usize) for value in block
+            `(total + [(write-value sink (deref value))])
+    if (string-array-ref-type? ('qualified-typeof sink))
+        spice-quote
+            local writer =
+                BufferWriter (& (sink @ 0)) (countof sink)
+            spice-unquote (sum-writes writer)
+            'finish writer
+    else
+        sum-writes sink
+
 do
     let integer->string bin oct dec hex
-    let format
+    let format format-into BufferWriter Stream
     locals;
@@ -524,10 +524,38 @@ inline dot (u v)
     let w = (u * v)
     vector-reduce (do +) (w as (storageof (typeof w)))
 
+inline cross (u v)
+    u.yzx * v.zxy - u.zxy * v.yzx
+
 #-------------------------------------------------------------------------------
 # MATRICES
 #-------------------------------------------------------------------------------
 
+# builds the constant shuffle mask `start, start + step, start + 2 * step, ...`
+    of size `sz`
+@@ memoize
+fn stride-mask (start step sz)
+    let entries = (alloca-array Value sz)
+    for i in (range sz)
+        let k = (start + i * step)
+        entries @ (i as usize) = `k
+    let VT = (vector.type i32 sz)
+    sc_const_aggregate_new VT sz entries
+
+fn real-matrix? (T)
+    let ET = ('element@ ('element@ T 0) 0)
+    (ET == f32) or (ET == f64)
+
+# for floating point matrices, `m * v` is computed as the sum of the columns
+    of `m` scaled by the elements of `v`; each term is a broadcast and a
+    vector multiply-add, instead of a horizontal dot product per element.
+fn combine-columns (m v cols rows)
+    inline term (k)
+        let mask = (stride-mask k 0 rows)
+        `((storagecast (extractvalue m k)) * (shufflevector v v mask))
+    fold (sum = (term 0)) for k in (range 1 cols)
+        `(sum + [(term k)])
+
 typedef+ mat-type
 
     inline __unpack (self)
@@ -684,6 +712,16 @@ typedef+ mat-type
                 dest-columns = (('@ rhsT 'Columns) as i32)
                 dest-rows = (('@ lhsT 'Rows) as i32)
             let destT = `(construct-mat-type ET dest-columns dest-rows)
+            if (real-matrix? lhsT)
+                let inner = (('@ lhsT 'Columns) as i32)
+                return
+                    spice-quote
+                        inline (lhs rhs)
+                            spice-unquote
+                                fold (mat = `(nullof destT)) for i in (range dest-columns)
+                                    let v = `(storagecast (extractvalue rhs i))
+                                    let vec = (combine-columns lhs v inner dest-rows)
+                                    `(insertvalue mat (bitcast vec VT) i)
             spice-quote
                 inline (lhs rhs)
                     spice-unquote
@@ -701,6 +739,15 @@ typedef+ mat-type
         elseif (rhsT == (('@ lhsT 'RowType) as type))
             let VT = ('element@ lhsT 0)
             let sz = ('element-count VT)
+            if (real-matrix? lhsT)
+                let cols = ('element-count lhsT)
+                return
+                    spice-quote
+                        inline (lhs rhs)
+                            let v = (storagecast rhs)
+                            bitcast
+                                spice-unquote (combine-columns lhs v cols sz)
+                                VT
             # mat(i,j) * vec(i) -> vec(j)
             spice-quote
                 inline (lhs rhs)
@@ -760,13 +807,114 @@ spice _transpose (m)
     let T = ('typeof m)
     assert (T < mat-type)
     let TT = (('@ T 'TransposedType) as type)
-    fold (self = `(nullof TT)) for i in (range (('@ T 'Rows) as i32))
-        `(insertvalue self ('row m i) i)
+    let RT = (('@ T 'RowType) as type)
+    let cols = (('@ T 'Columns) as i32)
+    let rows = (('@ T 'Rows) as i32)
+    # concatenate the columns into two vectors, then gather each row with a
+        single shuffle
+    inline column (i)
+        `(storagecast (extractvalue m [(min i (cols - 1))]))
+    let concat-mask = (stride-mask 0 1 (rows * 2))
+    let lo = `(shufflevector [(column 0)] [(column 1)] concat-mask)
+    let hi =
+        if (cols == 2) lo
+        else `(shufflevector [(column 2)] [(column 3)] concat-mask)
+    fold (self = `(nullof TT)) for i in (range rows)
+        let mask = (stride-mask i rows cols)
+        `(insertvalue self (bitcast (shufflevector lo hi mask) RT) i)
 
 @@ spice-quote
 inline transpose (m)
     _transpose m
 
+""""Returns the determinant of the square floating point matrix `m`.
+inline determinant (m)
+    let MT = (typeof m)
+    static-assert (MT < mat-type) "matrix expected"
+    static-assert (MT.Columns == MT.Rows) "matrix must be square"
+    let ET = MT.ElementType
+    static-assert ((ET == f32) or (ET == f64)) "floating point matrix expected"
+    static-match MT.Columns
+    case 2
+        let c0 c1 = (unpack m)
+        c0.x * c1.y - c1.x * c0.y
+    case 3
+        let c0 c1 c2 = (unpack m)
+        dot c0 (cross c1 c2)
+    default
+        let c0 c1 c2 c3 = (unpack m)
+        let V3 = (vec-type ET 3)
+        let a = (V3 c0.xyz)
+        let b = (V3 c1.xyz)
+        let c = (V3 c2.xyz)
+        let d = (V3 c3.xyz)
+        +
+            dot (cross a b) (c * c3.w - d * c2.w)
+            dot (cross c d) (a * c1.w - b * c0.w)
+
+""""Returns the inverse of the square floating point matrix `m`. The result
+    is undefined if `m` is singular.
+inline inverse (m)
+    let MT = (typeof m)
+    static-assert (MT < mat-type) "matrix expected"
+    static-assert (MT.Columns == MT.Rows) "matrix must be square"
+    let ET = MT.ElementType
+    static-assert ((ET == f32) or (ET == f64)) "floating point matrix expected"
+    static-match MT.Columns
+    case 2
+        let c0 c1 = (unpack m)
+        let invdet = ((ET 1) / (c0.x * c1.y - c1.x * c0.y))
+        MT
+            \ (c1.y * invdet) (- (c0.y * invdet))
+            \ (- (c1.x * invdet)) (c0.x * invdet)
+    case 3
+        let c0 c1 c2 = (unpack m)
+        # the rows of the inverse are perpendicular to two columns each
+        let r0 = (cross c1 c2)
+        let r1 = (cross c2 c0)
+        let r2 = (cross c0 c1)
+        let invdet = ((ET 1) / (dot c0 r0))
+        transpose (MT (r0 * invdet) (r1 * invdet) (r2 * invdet))
+    default
+        let c0 c1 c2 c3 = (unpack m)
+        let V3 = (vec-type ET 3)
+        let a = (V3 c0.xyz)
+        let b = (V3 c1.xyz)
+        let c = (V3 c2.xyz)
+        let d = (V3 c3.xyz)
+        let x y z w = (_ c0.w c1.w c2.w c3.w)
+        let s = (cross a b)
+        let t = (cross c d)
+        let u = (a * y - b * x)
+        let v = (c * w - d * z)
+        let invdet = ((ET 1) / ((dot s v) + (dot t u)))
+        let s = (s * invdet)
+        let t = (t * invdet)
+        let u = (u * invdet)
+        let v = (v * invdet)
+        transpose
+            MT
+                (cross b v) + t * y; - (dot b t)
+                (cross v a) - t * x; dot a t
+                (cross d u) + s * w; - (dot d s)
+                (cross u c) - s * z; dot c s
+
+""""Stores `m * (src @ i)` in `dest @ i` for every `i` below `count`. `src` and
+    `dest` can be arrays or pointers of vectors, and may refer to the same
+    memory.
+inline transform-many (m src dest count)
+    for i in (range count)
+        dest @ i = m * (deref (src @ i))
+
+""""Stores `m * (RowType (src @ i) 1)` in `dest @ i` for every `i` below
+    `count`, transforming points that are one element shorter than the rows
+    of `m`, e.g. `vec3` by `mat4x3` or `mat4`.
+inline transform-points (m src dest count)
+    let MT = (typeof m)
+    let one = (MT.ElementType 1)
+    for i in (range count)
+        dest @ i = m * (MT.RowType (deref (src @ i)) one)
+
 spice mix (a b x)
     let Ta = ('typeof a)
     let Tx = ('typeof x)
@@ -810,5 +958,6 @@ do
     let mat4x4 dmat4x4 imat4x4 umat4x4 bmat4x4
     let mat4 dmat4 imat4 umat4 bmat4
 
-    let dot transpose mix
+    let dot cross transpose determinant inverse mix
+    let transform-many transform-points
     locals;
@@ -25,6 +25,24 @@ spice va-ordered-insert (item fcmp vars...)
                         va-append-va (inline () (_ item (v2))) (v1)
                     expr
 
+""""The type of a random access sequence, which provides its element count and
+    a function that maps an index to an element. Unlike generators, counted
+    sequences have no iteration state, so that consumers can lower them to a
+    single counted loop which the LLVM vectorizer understands.
+typedef Counted : (storageof Closure)
+
+spice closure->counted (self)
+    if (not ('constant? self))
+        error "Closure must be constant"
+    let self = (bitcast (self as Closure) Counted)
+    `self
+
+spice counted-unpack (self)
+    if (not ('constant? self))
+        error "Counted must be constant"
+    let self = (bitcast (self as Counted) Closure)
+    `(self)
+
 run-stage;
 
 #---------------------------------------------------------------------------
@@ -289,6 +307,137 @@ inline closest (gen n fcmp)
         repeat
             va-append-va (inline () best...) (next it...)
 
+#---------------------------------------------------------------------------
+# counted sequences
+#---------------------------------------------------------------------------
+
+typedef+ Counted
+    """"Takes the element count `count` and a function `at` which returns the
+        element at a given index, and returns a new counted sequence.
+    inline __typecall (cls count at)
+        closure->counted
+            inline () (_ (count as usize) at)
+
+    """"Returns the element count and the element function of the sequence.
+    inline __call (self)
+        counted-unpack self
+
+    inline __countof (self)
+        let count at = (counted-unpack self)
+        count
+
+    inline __as (cls T)
+        static-if (T == Generator)
+            inline (self)
+                let count at = (counted-unpack self)
+                Generator
+                    inline () 0:usize
+                    inline (i) (i < count)
+                    inline (i) (at i)
+                    inline (i) (i + 1:usize)
+
+""""Returns `x` as a counted sequence. `x` can be a counted sequence, an
+    integer `n`, which yields the indices from 0 to `n`, or any value that
+    supports `countof` and `@`, such as arrays, vectors and strings.
+inline countable (x)
+    let T = (typeof x)
+    static-if (T == Counted) x
+    elseif ((unqualified T) < integer)
+        Counted x
+            inline (i) i
+    else
+        Counted (countof x)
+            inline (i) (x @ i)
+
+""""Returns a counted sequence that applies `f` to the elements of the
+    sequences `x...`, which are converted with `countable`. The sequence is as
+    long as the shortest of `x...`.
+inline cmap (f x...)
+    let count =
+        static-if ((va-countof x...) == 1) (countof (countable x...))
+        else
+            min
+                va-map
+                    inline (x) (countof (countable x))
+                    x...
+    Counted count
+        inline (i)
+            f
+                va-map
+                    inline (x)
+                        let n at = ((countable x))
+                        at i
+                    x...
+
+""""Returns a counted sequence of counted sequences, each covering `n`
+    consecutive elements of `x`; the last chunk may be shorter.
+inline chunked (n x)
+    let count at = ((countable x))
+    let n = (n as usize)
+    Counted ((count + n - 1:usize) // n)
+        inline (i)
+            let offset = (i * n)
+            Counted (min n (count - offset))
+                inline (j) (at (offset + j))
+
+""""Returns a counted sequence of vectors with `N` lanes each, gathered from
+    consecutive scalar elements of `x`. Lanes past the end of `x` are set to
+    `pad`, which defaults to zero. Together with `reduce`, this turns
+    reductions into SIMD code without relying on the vectorizer, which may not
+    reassociate floating point arithmetic.
+inline vectorize (N x pad)
+    static-assert (constant? N) "lane count must be constant"
+    let count at = ((countable x))
+    let n = (N as usize)
+    let lanes... = (va-range 1 N)
+    Counted ((count + n - 1:usize) // n)
+        inline (i)
+            let offset = (i * n)
+            # the first lane always exists
+            let first = (at offset)
+            let ET = (typeof first)
+            if ((offset + n) <= count)
+                vectorof ET first
+                    va-map
+                        inline (k) (at (offset + k))
+                        lanes...
+            else
+                # the last vector is padded
+                let pad =
+                    static-if (none? pad) (nullof ET)
+                    else (pad as ET)
+                vectorof ET first
+                    va-map
+                        inline (k)
+                            let index = (offset + k)
+                            if (index < count) (at index)
+                            else pad
+                        lanes...
+
+""""Writes the elements of counted sequence `x` to `dest @ 0`, `dest @ 1`, ...,
+    and returns the number of elements written. `dest` must have room for
+    `countof x` elements and may be the source of `x`.
+inline write-into (x dest)
+    let count at = ((countable x))
+    loop (i = 0:usize)
+        if (i == count)
+            break count
+        dest @ i = (at i)
+        i + 1:usize
+
+""""Writes the elements of `x` for which `f` returns true to `dest @ 0`,
+    `dest @ 1`, ..., and returns the number of elements written. Every element
+    is stored before it is tested, so that the loop doesn't branch; `dest`
+    must have room for `countof x` elements.
+inline filter-into (f x dest)
+    let count at = ((countable x))
+    loop (i k = 0:usize 0:usize)
+        if (i == count)
+            break k
+        let value = (at i)
+        dest @ k = value
+        _ (i + 1:usize) (? (f value) (k + 1:usize) k)
+
 #---------------------------------------------------------------------------
 # collectors
 #---------------------------------------------------------------------------
@@ -409,13 +558,36 @@ inline map (f coll)
     static-if (none? coll) _map
     else (_map coll)
 
-inline reduce (init f)
-    Collector
-        inline () init
-        inline (it) true
-        inline (it) it
-        inline (src it)
-            f it (src)
+inline reduce (init f x)
+    """"Without `x`, returns a collector that folds its input into `init` with
+        `f`. Otherwise, folds the counted sequence `x` into `init` in a single
+        counted loop and returns the result. If the elements of `x` are vectors
+        and `init` is not, the vectors are accumulated lane by lane, and the
+        lanes are combined with `init` at the end, so `f` must be associative.
+    static-if (none? x)
+        Collector
+            inline () init
+            inline (it) true
+            inline (it) it
+            inline (src it)
+                f it (src)
+    else
+        let count at = ((countable x))
+        if (count == 0:usize) init
+        else
+            let first = (at 0:usize)
+            static-if (((typeof first) < vector) and (not ((typeof init) < vector)))
+                let acc =
+                    loop (i acc = 1:usize first)
+                        if (i == count)
+                            break acc
+                        _ (i + 1:usize) (f acc (at i))
+                f init (vector-reduce f acc)
+            else
+                loop (i acc = 1:usize (f init first))
+                    if (i == count)
+                        break acc
+                    _ (i + 1:usize) (f acc (at i))
 
 let drain =
     Collector
@@ -679,5 +851,6 @@ do
     let span dim bitdim imap ipair join zip span join collect each compose cat
         \ ->> flatten map reduce drain limit gate filter take cascade mux
         \ demux retain permutate-range iterbits closest va-ordered-insert
+        \ Counted countable cmap chunked vectorize write-into filter-into
 
     locals;
@@ -0,0 +1,720 @@
+#
+    The Scopes Compiler Infrastructure
+    This file is distributed under the MIT License.
+    See LICENSE.md for details.
+
+""""parallel
+    ========
+
+    A work-stealing task scheduler for running code on all cores.
+
+    A pool of worker threads, one less than the number of processors, is
+    started on first use. Every worker owns a task queue; it pushes and pops
+    tasks at the back of its own queue and steals the oldest tasks from the
+    front of the other queues when it runs out of work. Threads that are not
+    workers submit to a shared queue. A thread that waits for a result runs
+    pending tasks in the meantime instead of blocking.
+
+    Tasks are plain functions, closures created with `capture` or `Capture`
+    values; `spawn` runs them asynchronously and returns a `Future`.
+    `parallel-for` and `parallel-reduce` split index ranges or arrays into
+    chunks sized for the number of threads.
+
+using import struct
+using import Array
+
+vvv bind C
+static-if (operating-system == 'windows)
+    include
+        """"#define WIN32_LEAN_AND_MEAN
+            #include <windows.h>
+            #include <stdlib.h>
+
+            typedef void *(*__scopes_thread_func)(void *);
+
+            int __scopes_parallel_cpu_count(void) {
+                SYSTEM_INFO info;
+                GetSystemInfo(&info);
+                return (info.dwNumberOfProcessors < 1)?1:(int)info.dwNumberOfProcessors;
+            }
+
+            typedef struct {
+                __scopes_thread_func f;
+                void *arg;
+            } __scopes_thread_start;
+
+            static DWORD WINAPI thread_main(LPVOID param) {
+                __scopes_thread_start start = *(__scopes_thread_start *)param;
+                free(param);
+                start.f(start.arg);
+                return 0;
+            }
+
+            int __scopes_parallel_start_thread(__scopes_thread_func f, void *arg) {
+                HANDLE thread;
+                __scopes_thread_start *start =
+                    (__scopes_thread_start *)malloc(sizeof(__scopes_thread_start));
+                if (!start)
+                    return -1;
+                start->f = f;
+                start->arg = arg;
+                thread = CreateThread(0, 0, thread_main, start, 0, 0);
+                if (!thread) {
+                    free(start);
+                    return -1;
+                }
+                CloseHandle(thread);
+                return 0;
+            }
+
+            static DWORD worker_key;
+
+            void __scopes_parallel_init_key(void) {
+                worker_key = TlsAlloc();
+            }
+
+            void __scopes_parallel_set_worker(void *worker) {
+                TlsSetValue(worker_key, worker);
+            }
+
+            void *__scopes_parallel_get_worker(void) {
+                return TlsGetValue(worker_key);
+            }
+
+            void __scopes_parallel_yield(void) {
+                SwitchToThread();
+            }
+
+            static SRWLOCK sleep_lock = SRWLOCK_INIT;
+            static CONDITION_VARIABLE sleep_cond = CONDITION_VARIABLE_INIT;
+            static unsigned long sleep_epoch = 0;
+            static int sleepers = 0;
+
+            /* announce the intent to sleep; the caller must look for work once
+               more before passing the returned epoch to sleep() */
+            unsigned long __scopes_parallel_prepare_sleep(void) {
+                unsigned long epoch;
+                __atomic_add_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+                AcquireSRWLockExclusive(&sleep_lock);
+                epoch = sleep_epoch;
+                ReleaseSRWLockExclusive(&sleep_lock);
+                return epoch;
+            }
+
+            void __scopes_parallel_cancel_sleep(void) {
+                __atomic_sub_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+            }
+
+            void __scopes_parallel_sleep(unsigned long epoch) {
+                AcquireSRWLockExclusive(&sleep_lock);
+                while (sleep_epoch == epoch)
+                    SleepConditionVariableSRW(&sleep_cond, &sleep_lock, INFINITE, 0);
+                ReleaseSRWLockExclusive(&sleep_lock);
+                __atomic_sub_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+            }
+
+            void __scopes_parallel_wake(void) {
+                if (__atomic_load_n(&sleepers, __ATOMIC_SEQ_CST) > 0) {
+                    AcquireSRWLockExclusive(&sleep_lock);
+                    sleep_epoch++;
+                    WakeAllConditionVariable(&sleep_cond);
+                    ReleaseSRWLockExclusive(&sleep_lock);
+                }
+            }
+else
+    include
+        """"#include <pthread.h>
+            #include <sched.h>
+            #include <unistd.h>
+
+            typedef void *(*__scopes_thread_func)(void *);
+
+            int __scopes_parallel_cpu_count(void) {
+                long n = sysconf(_SC_NPROCESSORS_ONLN);
+                return (n < 1)?1:(int)n;
+            }
+
+            int __scopes_parallel_start_thread(__scopes_thread_func f, void *arg) {
+                pthread_t thread;
+                int err = pthread_create(&thread, 0, f, arg);
+                if (!err)
+                    pthread_detach(thread);
+                return err;
+            }
+
+            static pthread_key_t worker_key;
+
+            void __scopes_parallel_init_key(void) {
+                pthread_key_create(&worker_key, 0);
+            }
+
+            void __scopes_parallel_set_worker(void *worker) {
+                pthread_setspecific(worker_key, worker);
+            }
+
+            void *__scopes_parallel_get_worker(void) {
+                return pthread_getspecific(worker_key);
+            }
+
+            void __scopes_parallel_yield(void) {
+                sched_yield();
+            }
+
+            static pthread_mutex_t sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+            static pthread_cond_t sleep_cond = PTHREAD_COND_INITIALIZER;
+            static unsigned long sleep_epoch = 0;
+            static int sleepers = 0;
+
+            /* announce the intent to sleep; the caller must look for work once
+               more before passing the returned epoch to sleep() */
+            unsigned long __scopes_parallel_prepare_sleep(void) {
+                unsigned long epoch;
+                __atomic_add_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+                pthread_mutex_lock(&sleep_lock);
+                epoch = sleep_epoch;
+                pthread_mutex_unlock(&sleep_lock);
+                return epoch;
+            }
+
+            void __scopes_parallel_cancel_sleep(void) {
+                __atomic_sub_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+            }
+
+            void __scopes_parallel_sleep(unsigned long epoch) {
+                pthread_mutex_lock(&sleep_lock);
+                while (sleep_epoch == epoch)
+                    pthread_cond_wait(&sleep_cond, &sleep_lock);
+                pthread_mutex_unlock(&sleep_lock);
+                __atomic_sub_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+            }
+
+            void __scopes_parallel_wake(void) {
+                if (__atomic_load_n(&sleepers, __ATOMIC_SEQ_CST) > 0) {
+                    pthread_mutex_lock(&sleep_lock);
+                    sleep_epoch++;
+                    pthread_cond_broadcast(&sleep_cond);
+                    pthread_mutex_unlock(&sleep_lock);
+                }
+            }
+
+# number of times an idle worker looks for work before it goes to sleep
+let SPIN_LIMIT = 64
+# ranges are split into this many chunks per thread, so that threads that
+    finish early can steal work from the others
+let CHUNKS_PER_THREAD = 8:i64
+
+let TaskFunctionType = (pointer (function void voidstar))
+
+struct Task plain
+    func : TaskFunctionType
+    env : voidstar
+
+struct TaskQueue plain
+    lock : i32
+    head : usize
+    tail : usize
+    capacity : usize
+    items : (mutable pointer Task)
+
+# 0 = not started, 1 = starting, 2 = running
+global pool-state = 0
+global queue-count = 0
+global queues : (mutable pointer TaskQueue)
+
+inline lock-queue (q)
+    loop ()
+        let old locked? = (cmpxchg (& q.lock) 0 1)
+        if locked?
+            break;
+        (C.extern.__scopes_parallel_yield)
+        repeat;
+
+inline unlock-queue (q)
+    atomicrmw xchg (& q.lock) 0
+    ;
+
+fn queue-push (q task)
+    let q = (@ q)
+    lock-queue q
+    if ((q.tail - q.head) == q.capacity)
+        let count = (q.tail - q.head)
+        let new-capacity = (max 16:usize (q.capacity * 2:usize))
+        let new-items = (malloc-array Task new-capacity)
+        for i in (range count)
+            (new-items @ i) = (q.items @ ((q.head + i) % q.capacity))
+        if (q.capacity > 0)
+            free (deref q.items)
+        q.items = new-items
+        q.capacity = new-capacity
+        q.head = 0:usize
+        q.tail = count
+    (q.items @ (q.tail % q.capacity)) = task
+    q.tail += 1:usize
+    unlock-queue q
+
+# the owning worker takes the most recently pushed task
+fn queue-pop (q)
+    let q = (@ q)
+    lock-queue q
+    if (q.tail == q.head)
+        unlock-queue q
+        return false (nullof Task)
+    q.tail -= 1:usize
+    let task = (deref (q.items @ (q.tail % q.capacity)))
+    unlock-queue q
+    _ true task
+
+# other threads take the oldest task
+fn queue-steal (q)
+    let q = (@ q)
+    lock-queue q
+    if (q.tail == q.head)
+        unlock-queue q
+        return false (nullof Task)
+    let task = (deref (q.items @ (q.head % q.capacity)))
+    q.head += 1:usize
+    unlock-queue q
+    _ true task
+
+# index of the queue owned by the current thread, or -1 if it is not a worker
+fn current-worker ()
+    ((ptrtoint (C.extern.__scopes_parallel_get_worker) usize) as i32) - 1
+
+fn find-task (index)
+    let queues = (deref queues)
+    let shared = ((deref queue-count) - 1)
+    if (index >= 0)
+        let found? task = (queue-pop (getelementptr queues index))
+        if found?
+            return found? task
+    let found? task = (queue-steal (getelementptr queues shared))
+    if found?
+        return found? task
+    # start at a different victim on every worker to spread contention
+    let start = (max index 0)
+    for k in (range shared)
+        let victim = ((start + k) % shared)
+        if (victim != index)
+            let found? task = (queue-steal (getelementptr queues victim))
+            if found?
+                return found? task
+    _ false (nullof Task)
+
+inline run-task (task)
+    (deref task.func) (deref task.env)
+
+fn worker-main (arg)
+    returning (mutable voidstar)
+    let index = ((ptrtoint arg usize) as i32)
+    C.extern.__scopes_parallel_set_worker
+        inttoptr ((index + 1) as usize) (mutable voidstar)
+    loop (idle = 0)
+        let found? task = (find-task index)
+        if found?
+            run-task task
+            repeat 0
+        if (idle < SPIN_LIMIT)
+            (C.extern.__scopes_parallel_yield)
+            repeat (idle + 1)
+        let epoch = (C.extern.__scopes_parallel_prepare_sleep)
+        let found? task = (find-task index)
+        if found?
+            (C.extern.__scopes_parallel_cancel_sleep)
+            run-task task
+        else
+            C.extern.__scopes_parallel_sleep epoch
+        0
+
+fn init-pool ()
+    if ((deref pool-state) == 2)
+        return;
+    let old first? = (cmpxchg (& pool-state) 0 1)
+    if first?
+        (C.extern.__scopes_parallel_init_key)
+        let workers = (max 1 ((C.extern.__scopes_parallel_cpu_count) - 1))
+        # the last queue is shared by all threads that are not workers
+        let count = (workers + 1)
+        let new-queues = (malloc-array TaskQueue (count as usize))
+        for i in (range count)
+            (new-queues @ i) = (nullof TaskQueue)
+        queues = new-queues
+        queue-count = count
+        atomicrmw xchg (& pool-state) 2
+        let main = (static-typify worker-main (mutable voidstar))
+        for i in (range workers)
+            let err =
+                C.extern.__scopes_parallel_start_thread main
+                    inttoptr (i as usize) (mutable voidstar)
+            assert (err == 0) "failed to start worker thread"
+    else
+        while ((atomicrmw add (& pool-state) 0) != 2)
+            (C.extern.__scopes_parallel_yield)
+    ;
+
+fn submit (task)
+    let index = (current-worker)
+    let q =
+        getelementptr (deref queues)
+            ? (index >= 0) index ((deref queue-count) - 1)
+    queue-push q task
+    (C.extern.__scopes_parallel_wake)
+
+# run pending tasks on the current thread until `done?` returns true
+inline wait-until (done?)
+    let index = (current-worker)
+    loop ()
+        if (done?)
+            break;
+        let found? task = (find-task index)
+        if found?
+            run-task task
+        else
+            (C.extern.__scopes_parallel_yield)
+        repeat;
+
+""""Returns the number of threads that execute tasks, including the thread
+    that waits for them.
+fn thread-count ()
+    init-pool;
+    deref queue-count
+
+################################################################################
+# futures
+
+let
+    JOB_DONE = 0
+    JOB_RESULT = 1
+    JOB_FUNC = 2
+
+typedef Future
+
+# a job is a `tuple i32 result function`; futures only know the header up to
+    the result, so their type only depends on the result type
+@@ memo
+inline gen-future-type (R)
+    let ResultT =
+        static-if (R == void) (tuple)
+        else R
+    let HeaderT = (tuple i32 ResultT)
+    typedef (.. "<Future " (tostring R) ">") < Future :: (mutable pointer HeaderT)
+        let ResultType = R
+        let StorageResultType = ResultT
+
+@@ memo
+inline gen-job-type (F)
+    let call = (static-typify (fn (f) ((@ f))) (mutable pointer F))
+    let R = (unqualified (returnof (typeof call)))
+    let FutureT = (gen-future-type R)
+    let JobT = (tuple i32 FutureT.StorageResultType F)
+    let run =
+        static-typify
+            fn "run-job" (env)
+                let job = (bitcast env (mutable pointer JobT))
+                let f = (@ (getelementptr job 0 JOB_FUNC))
+                static-if (R == void)
+                    f;
+                else
+                    store (f) (getelementptr job 0 JOB_RESULT)
+                static-if (not (plain? F))
+                    __drop (view f)
+                    lose f
+                atomicrmw xchg (getelementptr job 0 JOB_DONE) 1
+                ;
+            voidstar
+    _ JobT FutureT run
+
+typedef+ Future
+    inline __typecall (cls R)
+        static-assert (cls == Future) "use spawn to create futures"
+        gen-future-type R
+
+    """"Returns true if the task of future `self` has completed.
+    fn ready? (self)
+        viewing self
+        let job = (storagecast self)
+        (atomicrmw add (getelementptr job 0 JOB_DONE) 0) != 0
+
+    """"Wait for the task of future `self` to complete and return its result.
+        The calling thread executes other pending tasks while it waits.
+    fn wait (self)
+        let job = (storagecast (view self))
+        wait-until (inline () (ready? self))
+        static-if (((typeof self) . ResultType) == void)
+            free job
+            lose self
+            ;
+        else
+            let result = (dupe (deref (@ (getelementptr job 0 JOB_RESULT))))
+            free job
+            lose self
+            result
+
+    fn _drop (self)
+        viewing self
+        let job = (storagecast self)
+        wait-until (inline () (ready? self))
+        static-if (not (plain? ((typeof self) . StorageResultType)))
+            __drop (@ (getelementptr job 0 JOB_RESULT))
+        free job
+
+    inline __drop (self)
+        _drop (deref self)
+
+    unlet _drop
+
+inline callable (f types...)
+    static-if ((typeof f) == Closure) (static-typify f types...)
+    else f
+
+""""Run `f`, which takes no arguments, on the thread pool and return a
+    `Future` for its result. `f` can be a function or a closure created with
+    `capture`; it is moved into the task.
+inline spawn (f)
+    let f = (callable f)
+    let JobT FutureT run = (gen-job-type (typeof f))
+    init-pool;
+    let job = (malloc JobT)
+    store 0 (getelementptr job 0 JOB_DONE)
+    store f (getelementptr job 0 JOB_FUNC)
+    submit (Task (func = run) (env = (bitcast job voidstar)))
+    bitcast (bitcast job (storageof FutureT)) FutureT
+
+""""Wait for all `futures...` and return their results in order.
+inline join (futures...)
+    va-map
+        inline (future) ('wait future)
+        futures...
+
+################################################################################
+# ranges
+
+let RangeBodyType = (pointer (function void voidstar i64 i64 i64))
+
+struct RangeJob plain
+    pending : i64
+    begin : i64
+    end : i64
+    grain : i64
+    body : RangeBodyType
+    env : voidstar
+    split : TaskFunctionType
+
+struct RangeTask plain
+    job : (mutable pointer RangeJob)
+    first : i64
+    last : i64
+
+# run chunks `first` to `last` of a range job; the upper half is split off
+    and offered to other threads until a single chunk is left
+fn run-range-task (env)
+    let taskptr = (bitcast env (mutable pointer RangeTask))
+    let task = (@ taskptr)
+    let jobptr = (deref task.job)
+    let first = (deref task.first)
+    let last = (deref task.last)
+    free taskptr
+    let job = (@ jobptr)
+    let last =
+        loop (last = last)
+            if ((last - first) <= 1:i64)
+                break last
+            let mid = (first + (last - first) // 2:i64)
+            let subtask = (malloc RangeTask)
+            store (RangeTask (job = jobptr) (first = mid) (last = last)) subtask
+            submit
+                Task (func = (deref job.split)) (env = (bitcast subtask voidstar))
+            mid
+    let grain = (deref job.grain)
+    let begin = (job.begin + first * grain)
+    let end = (min (deref job.end) (begin + grain))
+    (deref job.body) (deref job.env) first begin end
+    atomicrmw sub (& job.pending) 1:i64
+    ;
+
+fn chunk-count (begin end)
+    let count = (end - begin)
+    let threads = ((thread-count) as i64)
+    let grain = (max 1:i64 (count // (threads * CHUNKS_PER_THREAD)))
+    _ ((count + grain - 1:i64) // grain) grain
+
+# call `body env chunk begin end` for all chunks of the range `begin` to `end`
+    in parallel and return when all of them have completed
+fn run-range (begin end body env)
+    if (begin >= end)
+        return;
+    let chunks grain = (chunk-count begin end)
+    local job =
+        RangeJob
+            pending = chunks
+            begin = begin
+            end = end
+            grain = grain
+            body = body
+            env = env
+            split = (static-typify run-range-task voidstar)
+    let task = (malloc RangeTask)
+    store (RangeTask (job = (& job)) (first = 0:i64) (last = chunks)) task
+    run-range-task (bitcast task voidstar)
+    wait-until (inline () ((atomicrmw add (& job.pending) 0:i64) == 0:i64))
+
+@@ memo
+inline gen-for-body (F ET)
+    static-if (none? ET)
+        static-typify
+            fn (env chunk begin end)
+                let f = (@ (bitcast env (mutable pointer F)))
+                for i in (range begin end)
+                    f i
+            \ voidstar i64 i64 i64
+    else
+        let EnvT = (tuple (mutable pointer F) (mutable pointer ET))
+        static-typify
+            fn (env chunk begin end)
+                let env = (bitcast env (mutable pointer EnvT))
+                let f = (@ (load (getelementptr env 0 0)))
+                let items = (load (getelementptr env 0 1))
+                for i in (range begin end)
+                    f (items @ i)
+            \ voidstar i64 i64 i64
+
+@@ memo
+inline gen-reduce-body (F T ET)
+    let ItemT =
+        static-if (none? ET) i8
+        else ET
+    let EnvT =
+        tuple (mutable pointer F) (mutable pointer T) (mutable pointer T)
+            \ (mutable pointer ItemT)
+    static-typify
+        fn (env chunk begin end)
+            let env = (bitcast env (mutable pointer EnvT))
+            let f = (@ (load (getelementptr env 0 0)))
+            let init = (@ (load (getelementptr env 0 1)))
+            let partials = (load (getelementptr env 0 2))
+            let items = (load (getelementptr env 0 3))
+            let acc =
+                loop (i acc = begin (copy init))
+                    if (i == end)
+                        break acc
+                    _ (i + 1:i64)
+                        static-if (none? ET) (f acc i)
+                        else (f acc (items @ i))
+            store acc (getelementptr partials chunk)
+        \ voidstar i64 i64 i64
+
+inline for-range (begin end f)
+    local f = (callable f i64)
+    run-range (begin as i64) (end as i64) (gen-for-body (typeof f))
+        bitcast (& f) voidstar
+
+""""Call `f` for each index in the range `begin` to `end` (or `0` to `count`)
+    in parallel, or for each element of array `items`, and return when all
+    calls have completed. The range is split into chunks based on the number
+    of threads. `f` may be called from several threads at the same time.
+inline... parallel-for
+case (begin : integer, end : integer, f)
+    for-range begin end f
+case (count : integer, f)
+    for-range 0 count f
+case (items : Array, f)
+    let ET = ((typeof items) . ElementType)
+    local f = (callable f (mutable &ET))
+    local env = (tupleof (& f) (deref items._items))
+    run-range 0:i64 ((countof items) as i64) (gen-for-body (typeof f) ET)
+        bitcast (& env) voidstar
+
+struct ThreadJob plain
+    pending : i64
+    body : RangeBodyType
+    env : voidstar
+
+struct ThreadStart plain
+    job : (mutable pointer ThreadJob)
+    index : i64
+
+fn run-thread (arg)
+    returning (mutable voidstar)
+    let startptr = (bitcast arg (mutable pointer ThreadStart))
+    let start = (@ startptr)
+    let jobptr = (deref start.job)
+    let index = (deref start.index)
+    free startptr
+    let job = (@ jobptr)
+    (deref job.body) (deref job.env) index index (index + 1:i64)
+    atomicrmw sub (& job.pending) 1:i64
+    null
+
+# call `body env i i (i + 1)` for each index on its own thread; the calling
+    thread runs index 0
+fn run-on-threads (count body env)
+    if (count <= 0:i64)
+        return;
+    local job = (ThreadJob (pending = count) (body = body) (env = env))
+    let main = (static-typify run-thread (mutable voidstar))
+    for i in (range 1:i64 count)
+        let start = (malloc ThreadStart)
+        store (ThreadStart (job = (& job)) (index = i)) start
+        let err =
+            C.extern.__scopes_parallel_start_thread main
+                bitcast start (mutable voidstar)
+        assert (err == 0) "failed to start thread"
+    body env 0:i64 0:i64 1:i64
+    atomicrmw sub (& job.pending) 1:i64
+    while ((atomicrmw add (& job.pending) 0:i64) != 0:i64)
+        (C.extern.__scopes_parallel_yield)
+
+""""Call `f i` for each index `i` from `0` to `count`, each on a thread of
+    its own, and return when all calls have completed. Unlike `parallel-for`,
+    this starts `count - 1` new threads rather than using the pool, so the
+    number of threads running at the same time is exactly `count`.
+inline run-threads (count f)
+    local f = (callable f i64)
+    run-on-threads (count as i64) (gen-for-body (typeof f))
+        bitcast (& f) voidstar
+
+inline reduce-range (begin end init f combine items)
+    let begin = (begin as i64)
+    let end = (end as i64)
+    let T = (typeof init)
+    let ET =
+        static-if (none? items) none
+        else ((typeof items) . ElementType)
+    local init : T = init
+    local f =
+        static-if (none? ET) (callable f T i64)
+        else (callable f T (mutable &ET))
+    if (begin >= end)
+        deref init
+    else
+        let chunks = (chunk-count begin end)
+        let partials = (malloc-array T (chunks as usize))
+        let itemsptr =
+            static-if (none? ET) (nullof (mutable pointer i8))
+            else (deref items._items)
+        local env = (tupleof (& f) (& init) partials itemsptr)
+        run-range begin end (gen-reduce-body (typeof f) T ET)
+            bitcast (& env) voidstar
+        let result =
+            loop (i acc = 1:i64 (dupe (deref (partials @ 0))))
+                if (i == chunks)
+                    break acc
+                _ (i + 1:i64) (combine acc (dupe (deref (partials @ i))))
+        free partials
+        result
+
+""""Reduce the indices in the range `begin` to `end` (or `0` to `count`), or
+    the elements of array `items`, in parallel. Each chunk starts from a copy
+    of `init` and folds its indices or elements with `f acc x`; the partial
+    results are then combined in order with `combine a b` on the calling
+    thread. `init` must be an identity of `combine`.
+inline... parallel-reduce
+case (begin : integer, end : integer, init, f, combine)
+    reduce-range begin end init f combine none
+case (count : integer, init, f, combine)
+    reduce-range 0 count init f combine none
+case (items : Array, init, f, combine)
+    reduce-range 0 (countof items) init f combine items
+
+do
+    let Future spawn join thread-count parallel-for parallel-reduce run-threads
+    locals;
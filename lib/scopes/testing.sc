@@ -9,7 +9,7 @@
     The testing module simplifies writing and running tests in an ad-hoc
     fashion.
 
-fn __test-modules (module-dir modules)
+fn run-modules (kind module-dir modules)
     let total =
         i32 (countof modules)
 
@@ -23,7 +23,7 @@ fn __test-modules (module-dir modules)
                 for m in failed-modules
                     print "*" (m as Symbol as string)
             print;
-            print total "tests executed," (total - failed) "succeeded," failed "failed."
+            print total kind "executed," (total - failed) "succeeded," failed "failed."
             print "done."
             return;
 
@@ -46,6 +46,12 @@ fn __test-modules (module-dir modules)
             else
                 cons module failed-modules
 
+inline __test-modules (module-dir modules)
+    run-modules "tests" module-dir modules
+
+inline __bench-modules (module-dir modules)
+    run-modules "benchmark modules" module-dir modules
+
 let __test =
     spice-macro
         fn "__test" (args)
@@ -279,7 +285,229 @@ typedef One :: (tuple i32 (mutable pointer i32))
         ref = 0
         ;
 
+
+# benchmarks
+###################
+
+let BENCH_SAMPLES = 31
+# seconds spent running the benchmark before taking samples
+let BENCH_WARMUP = 0.1:f64
+# minimum duration of a single sample in seconds
+let BENCH_SAMPLE_TIME = 0.01:f64
+
+let llvm.readcyclecounter =
+    extern 'llvm.readcyclecounter (function u64)
+let getenv = (extern 'getenv (function rawstring rawstring))
+let fopen = (extern 'fopen (function voidstar rawstring rawstring))
+let fputs = (extern 'fputs (function i32 rawstring voidstar))
+let fclose = (extern 'fclose (function i32 voidstar))
+
+# returns a monotonic time in seconds
+fn wall-time ()
+    static-if (operating-system == 'windows)
+        let QueryPerformanceCounter =
+            extern 'QueryPerformanceCounter (function i32 (mutable pointer i64))
+        let QueryPerformanceFrequency =
+            extern 'QueryPerformanceFrequency (function i32 (mutable pointer i64))
+        local counter = 0:i64
+        local frequency = 1:i64
+        QueryPerformanceCounter &counter
+        QueryPerformanceFrequency &frequency
+        (f64 counter) / (f64 frequency)
+    else
+        let timespec = (tuple i64 i64)
+        let clock_gettime =
+            extern 'clock_gettime (function i32 i32 (mutable pointer timespec))
+        let CLOCK_MONOTONIC =
+            static-if (operating-system == 'macos) 6
+            else 1
+        local ts = (nullof timespec)
+        clock_gettime CLOCK_MONOTONIC &ts
+        (f64 (ts @ 0)) + (f64 (ts @ 1)) * 1e-9:f64
+
+vvv bind C
+include
+    """"#include <stdio.h>
+
+        int __scopes_bench_format(char *buf, int size, double value, int decimals) {
+            return snprintf(buf, size, "%.*f", decimals, value);
+        }
+
+fn format-real (value decimals)
+    local buf : (array i8 64)
+    let n = (C.extern.__scopes_bench_format (& (buf @ 0)) 64 (value as f64) decimals)
+    string (& (buf @ 0)) ((min n 63) as usize)
+
+fn format-duration (seconds)
+    if (seconds < 1e-6:f64)
+        .. (format-real (seconds * 1e9:f64) 2) " ns"
+    elseif (seconds < 1e-3:f64)
+        .. (format-real (seconds * 1e6:f64) 2) " us"
+    elseif (seconds < 1.0:f64)
+        .. (format-real (seconds * 1e3:f64) 2) " ms"
+    else
+        .. (format-real seconds 2) " s"
+
+fn json-escape (s)
+    let hex = "0123456789abcdef"
+    loop (i result = 0:usize "")
+        if (i == (countof s))
+            break result
+        local c = (s @ i)
+        let result =
+            if ((c == 34:i8) or (c == 92:i8))
+                .. result "\\" (string &c 1:usize)
+            elseif (c == 10:i8)
+                .. result "\\n"
+            elseif (c == 13:i8)
+                .. result "\\r"
+            elseif (c == 9:i8)
+                .. result "\\t"
+            elseif ((c >= 0:i8) and (c < 32:i8))
+                local hi = (hex @ ((c >> 4:i8) as usize))
+                local lo = (hex @ ((c & 15:i8) as usize))
+                .. result "\\u00" (string &hi 1:usize) (string &lo 1:usize)
+            else
+                .. result (string &c 1:usize)
+        _ (i + 1:usize) result
+
+# sorts `count` values at `values` in ascending order
+fn sort-samples (values count)
+    for i in (range 1 count)
+        let value = (deref (values @ i))
+        let j =
+            loop (j = i)
+                if ((j == 0) or ((values @ (j - 1)) <= value))
+                    break j
+                values @ j = (deref (values @ (j - 1)))
+                j - 1
+        values @ j = value
+
+fn percentile (sorted count p)
+    let pos = (p * (f64 (count - 1)))
+    let i = (pos as i32)
+    let lo = (deref (sorted @ i))
+    let hi = (deref (sorted @ (min (i + 1) (count - 1))))
+    lo + (hi - lo) * (pos - (f64 i))
+
+fn bench-report (name iterations times ticks count)
+    sort-samples times count
+    sort-samples ticks count
+    let median = (percentile times count 0.5:f64)
+    let deviations = (malloc-array f64 count)
+    for i in (range count)
+        deviations @ i = (abs ((times @ i) - median))
+    sort-samples deviations count
+    let mad = (percentile deviations count 0.5:f64)
+    free deviations
+    let p5 = (percentile times count 0.05:f64)
+    let p95 = (percentile times count 0.95:f64)
+    let sum =
+        fold (sum = 0.0:f64) for i in (range count)
+            sum + (times @ i)
+    let mean = (sum / (f64 count))
+    let ticks = (percentile ticks count 0.5:f64)
+    print "* bench" name
+    print "    median" (format-duration median) "+-" (format-duration mad) "MAD,"
+        \ (format-real ticks 0) "ticks"
+    print "    p5" (format-duration p5) " p95" (format-duration p95)
+        \ " mean" (format-duration mean)
+        \ " (" (format-real iterations 0) "iterations x" count "samples)"
+    let path = (getenv "SCOPES_BENCH_JSON")
+    if (path != null)
+        let f = (fopen path "a")
+        if (f != null)
+            inline ns (seconds)
+                format-real (seconds * 1e9:f64) 3
+            let line =
+                ..
+                    "{\"name\":\"" (json-escape name)
+                    "\",\"iterations\":" (format-real iterations 0)
+                    ",\"samples\":" (format-real count 0)
+                    ",\"median_ns\":" (ns median)
+                    ",\"mad_ns\":" (ns mad)
+                    ",\"mean_ns\":" (ns mean)
+                    ",\"min_ns\":" (ns (times @ 0))
+                    ",\"max_ns\":" (ns (times @ (count - 1)))
+                    ",\"p5_ns\":" (ns p5)
+                    ",\"p95_ns\":" (ns p95)
+                    ",\"ticks\":" (format-real ticks 0)
+                    "}\n"
+            fputs line f
+            fclose f
+    median
+
+inline __bench (name f)
+    inline run-batch (iterations)
+        for i in (range 0:u64 iterations)
+            f;
+    # warm up and double the number of iterations per sample until a sample
+        takes long enough to be measured reliably
+    let iterations =
+        loop (iterations elapsed = 1:u64 0.0:f64)
+            let t0 = (wall-time)
+            run-batch iterations
+            let t = ((wall-time) - t0)
+            let elapsed = (elapsed + t)
+            if ((t >= BENCH_SAMPLE_TIME) and (elapsed >= BENCH_WARMUP))
+                break iterations
+            _
+                ? (t < BENCH_SAMPLE_TIME) (iterations * 2:u64) iterations
+                elapsed
+    let times = (malloc-array f64 BENCH_SAMPLES)
+    # time stamp counter ticks, which do not follow the core clock
+    let ticks = (malloc-array f64 BENCH_SAMPLES)
+    for i in (range BENCH_SAMPLES)
+        let c0 = (llvm.readcyclecounter)
+        let t0 = (wall-time)
+        run-batch iterations
+        let t1 = (wall-time)
+        let c1 = (llvm.readcyclecounter)
+        times @ i = ((t1 - t0) / (f64 iterations))
+        ticks @ i = ((f64 (c1 - c0)) / (f64 iterations))
+    let median = (bench-report (name as string) iterations times ticks BENCH_SAMPLES)
+    free times
+    free ticks
+    median
+
+""""Runs `body` repeatedly and reports the time per execution.
+
+    Usage:
+
+        :::scopes
+        bench "name"
+            body ...
+
+    The benchmark is warmed up first, and the number of executions per sample
+    is doubled until a sample takes at least 10 ms. The median, median
+    absolute deviation, 5th and 95th percentile, mean and median count of
+    cycle counter ticks of 31 samples are printed, and the median time in seconds is returned.
+    When the environment variable `SCOPES_BENCH_JSON` names a file, a line
+    with the results in JSON format is appended to it.
+
+    Use `black-box` on inputs and results of `body` to keep the optimizer
+    from folding or removing the measured code.
+define-sugar-macro bench
+    let name body = (decons args)
+    list __bench name
+        cons inline '() body
+
+""""Returns `value` unchanged, but hides it from the optimizer, which must
+    then assume that it can be any value, and that it is used.
+inline black-box (value)
+    static-assert (plain? (typeof value)) "plain value expected"
+    let ptr = (alloca (typeof value))
+    volatile-store value ptr
+    volatile-load ptr
+
+# (bench-modules module ...)
+define-sugar-macro bench-modules
+    list __bench-modules 'module-dir
+        list sugar-quote
+            args
+
 do
     let One features test-compiler-error test-error test test-modules
+    let bench bench-modules black-box
 
     locals;
@@ -40,6 +40,7 @@
 
 #include <fcntl.h>
 #include <cstdlib>
+#include <stdio.h>
 #include <string.h>
 
 #if SCOPES_USE_WCHAR
@@ -58,6 +59,8 @@ void on_startup() {
 
 void on_shutdown() {
     delete main_compile_time;
+    main_compile_time = nullptr;
+    Timer::print_report();
 #if SCOPES_PRINT_TIMERS
     //print_profiler_info();
     Timer::print_timers();
@@ -206,6 +209,25 @@ static void setup_stdio() {
     }
 }
 
+// the time report has to be enabled before the compiler boots, so its option
+// is picked up here; core.sc skips it when parsing the command line
+static void parse_boot_options(int argc, char *argv[]) {
+    if (!argv)
+        return;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (!arg || (arg[0] != '-'))
+            break;
+        if (!strcmp(arg, "-c") || !strcmp(arg, "-m"))
+            break;
+        if (!strcmp(arg, "--time-report")) {
+            Timer::enable_report(false);
+        } else if (!strcmp(arg, "--time-report=json")) {
+            Timer::enable_report(true);
+        }
+    }
+}
+
 void init(void *c_main, int argc, char *argv[]) {
     using namespace scopes;
     scopes_compiler_path = nullptr;
@@ -226,10 +248,14 @@ void init(void *c_main, int argc, char *argv[]) {
     }
 #endif
 
+    parse_boot_options(argc, argv);
     on_startup();
 
     Symbol::_init_symbols();
-    init_llvm();
+    {
+        TimerSection section("init_llvm()");
+        init_llvm();
+    }
 
     setup_stdio();
 
@@ -252,14 +278,26 @@ void init(void *c_main, int argc, char *argv[]) {
         scopes_compiler_dir = String::from_cstr(result?result:compiler_dir)->data;
     }
 
-    init_types();
-    init_globals(argc, argv);
+    {
+        TimerSection section("init_types()");
+        init_types();
+    }
+    {
+        TimerSection section("init_globals()");
+        init_globals(argc, argv);
+    }
 }
 
 SCOPES_RESULT(int) try_main() {
     SCOPES_RESULT_TYPE(int);
     using namespace scopes;
 
+    // an error returns from anywhere below, so close what it leaves open
+    struct CloseSections {
+        ~CloseSections() { Timer::end_open_sections(); }
+    } close_sections;
+    Timer::begin_section("core.sc");
+    Timer::begin_section("parse");
     ValueRef expr = SCOPES_GET_RESULT(load_custom_core(scopes_compiler_path));
     if (expr) {
         goto skip_regular_load;
@@ -285,9 +323,12 @@ SCOPES_RESULT(int) try_main() {
     }
 
 skip_regular_load:
+    Timer::end_section();
     const Anchor *anchor = expr.anchor();
     auto list = SCOPES_GET_RESULT(extract_list_constant(expr));
+    Timer::begin_section("expand_module()");
     TemplateRef tmpfn = SCOPES_GET_RESULT(expand_module(anchor, list, sc_get_globals()));
+    Timer::end_section();
 
 #if 0 //SCOPES_DEBUG_CODEGEN
     StyledStream ss(std::cout);
@@ -296,7 +337,9 @@ skip_regular_load:
     std::cout << std::endl;
 #endif
 
+    Timer::begin_section("prove()");
     FunctionRef fn = SCOPES_GET_RESULT(prove(FunctionRef(), tmpfn, {}));
+    Timer::end_section();
 
     auto main_func_type = native_opaque_pointer_type(raising_function_type(
         arguments_type({}), {}));
@@ -305,20 +348,31 @@ skip_regular_load:
         arguments_type({TYPE_CompileStage}), {}));
 
     const int compile_flags = CF_Module;
+    int stage = 0;
 
 compile_stage:
     if (fn->get_type() == stage_func_type) {
+        char stage_name[32];
+        snprintf(stage_name, sizeof(stage_name), "stage %i", ++stage);
+        Timer::begin_section(stage_name);
         typedef sc_valueref_raises_t (*StageFuncType)();
-        StageFuncType fptr = (StageFuncType)SCOPES_GET_RESULT(compile(fn, compile_flags))->value;
+        auto ptr = SCOPES_GET_RESULT(compile(fn, compile_flags));
+        // batched code must not fail to emit once it is called
+        SCOPES_CHECK_RESULT(flush_compiled());
+        StageFuncType fptr = (StageFuncType)ptr->value;
         auto result = fptr();
         if (!result.ok) {
             SCOPES_RETURN_ERROR(result.except);
         }
+        // nothing calls the stage again; it is unloaded by a later collection
+        SCOPES_CHECK_RESULT(release_compiled(ptr));
+        Timer::end_section();
         auto value = result._0;
         if (value.isa<Function>()) {
             fn = value.cast<Function>();
             goto compile_stage;
         } else {
+            Timer::end_section();
             return 0;
         }
     }
@@ -336,7 +390,11 @@ compile_stage:
 #endif
 
     typedef sc_void_raises_t (*MainFuncType)();
+    Timer::begin_section("compile main");
     MainFuncType fptr = (MainFuncType)SCOPES_GET_RESULT(compile(fn, compile_flags))->value;
+    Timer::end_section();
+    // the remaining time is spent in the program and the modules it imports
+    Timer::end_section();
     {
         auto result = fptr();
         if (!result.ok) {
@@ -1132,7 +1132,13 @@ SCOPES_RESULT(const Scope *) import_c_module (
         M = (LLVMModuleRef)Act->takeModule().release();
         assert(M);
         llvm_c_modules.push_back(M);
-        if (!object_file.empty()) {
+        auto is_bitcode = [](const std::string &name) {
+            return (name.size() > 3) && !name.compare(name.size() - 3, 3, ".bc");
+        };
+        if (!object_file.empty() && is_bitcode(object_file)) {
+            // for the ThinLTO link step
+            SCOPES_CHECK_RESULT(write_summary_bitcode(M, object_file.c_str()));
+        } else if (!object_file.empty()) {
             auto target_machine = get_object_target_machine();
             assert(target_machine);
 
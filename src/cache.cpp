@@ -41,6 +41,8 @@
 namespace scopes {
 
 static int cache_misses = 0;
+static int total_cache_hits = 0;
+static int total_cache_misses = 0;
 static bool cache_inited = false;
 static char cache_dir[PATH_MAX+1];
 
@@ -49,6 +51,11 @@ int get_cache_misses() {
     cache_misses = 0;
     return val;
 }
+
+void get_cache_totals(int &hits, int &misses) {
+    hits = total_cache_hits;
+    misses = total_cache_misses;
+}
 // delete half of all cache files to make space, and/or half of all inodes
 // to stay within filesystem limits.
 static void perform_thanos_finger_snap(size_t cache_size, size_t num_files) {
@@ -252,6 +259,7 @@ const char *get_cache_file(const String *key) {
             // exists
             //StyledStream ss;
             //std::cout << "reusing " << filepath << std::endl;
+            total_cache_hits++;
             return filepath;
         }
     }
@@ -259,9 +267,35 @@ const char *get_cache_file(const String *key) {
     //StyledStream ss;
     //std::cout << "generating " << filepath << std::endl;
     cache_misses++;
+    total_cache_misses++;
     return nullptr;
 }
 
+const String *get_cache_content(const String *key) {
+    const char *filepath = get_cache_file(key);
+    if (!filepath)
+        return nullptr;
+
+    auto f = gzopen(filepath, "rb");
+    if (!f) {
+        return nullptr;
+    }
+    std::vector<char> data;
+    char buf[8192];
+    while (true) {
+        int r = gzread(f, buf, sizeof(buf));
+        if (r < 0) {
+            gzclose(f);
+            return nullptr;
+        }
+        if (!r)
+            break;
+        data.insert(data.end(), buf, buf + r);
+    }
+    gzclose(f);
+    return String::from(data.data(), data.size());
+}
+
 void set_cache(const String *key,
     const char *key_content, size_t key_size,
     const char *content, size_t size) {
@@ -16,9 +16,13 @@ struct String;
 
 const String *get_cache_key(uint64_t hash, const char *content, size_t size);
 int get_cache_misses();
+// lookups since startup, for the time report
+void get_cache_totals(int &hits, int &misses);
 const char *get_cache_dir();
 const char *get_cache_file(const String *key);
 const char *get_cache_key_file(const String *key);
+// returns the decompressed content of a cache entry or null on a miss
+const String *get_cache_content(const String *key);
 void set_cache(const String *key,
     const char *key_content, size_t key_size,
     const char *content, size_t size);
@@ -21,6 +21,11 @@ namespace scopes {
     T(CF_O3, (CF_O1 | CF_O2), "compile-flag-O3") \
     T(CF_Cache, (1 << 7), "compile-flag-cache") \
     T(CF_Module, (1 << 8), "compile-flag-module") \
+    T(CF_ProfileGenerate, (1 << 9), "compile-flag-profile-generate") \
+    T(CF_ProfileUse, (1 << 10), "compile-flag-profile-use") \
+    T(CF_Parallel, (1 << 11), "compile-flag-parallel") \
+    T(CF_ThinLTO, (1 << 12), "compile-flag-thin-lto") \
+    T(CF_FullDebugInfo, (1 << 13), "compile-flag-full-debug-info") \
 
 enum {
 #define T(NAME, VALUE, SNAME) \
@@ -417,6 +417,11 @@ formatters:
         "codegen: backend failed to validate generated code") \
     T(CGenBackendOptimizationFailed, \
         "codegen: backend failed to optimize generated code") \
+    T(CGenProfileInputMissing, \
+        "codegen: profile-use requested but no profile input has been set") \
+    T(CGenProfileFailed, \
+        "codegen: profile: %0", \
+        PString) \
     T(CGenUnsupportedDimensionality, \
         "codegen: unsupported dimensionality: %0", \
         Symbol) \
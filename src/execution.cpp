@@ -11,6 +11,7 @@
 #include "cache.hpp"
 #include "compiler_flags.hpp"
 #include "timer.hpp"
+#include "styled_stream.hpp"
 
 #ifdef SCOPES_WIN32
 #include "dlfcn.h"
@@ -20,6 +21,13 @@
 #include <dlfcn.h>
 #endif
 
+#ifdef SCOPES_LINUX
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
 #include <llvm-c/Core.h>
 #include <llvm-c/TargetMachine.h>
 #include <llvm-c/Support.h>
@@ -28,21 +36,53 @@
 #include <llvm-c/OrcEE.h>
 #include <llvm-c/Disassembler.h>
 
+#include <llvm-c/Linker.h>
 #include <llvm-c/Transforms/PassManagerBuilder.h>
 #include <llvm-c/Transforms/InstCombine.h>
 #include <llvm-c/Transforms/IPO.h>
 
 #include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/BinaryFormat/ELF.h"
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LazyReexports.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/ADT/Triple.h"
 #include "llvm/Object/SymbolSize.h"
 
 #include "llvm/Support/TargetSelect.h"
 
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/ProfileData/InstrProf.h"
+#include "llvm/ProfileData/InstrProfReader.h"
+#include "llvm/ProfileData/InstrProfWriter.h"
+#include "llvm/Transforms/Instrumentation.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/LTO/LTO.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Threading.h"
+#if LLVM_VERSION_MAJOR >= 14
+#include "llvm/Support/Caching.h"
+#endif
+
 #include <limits.h>
 
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 #include <vector>
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
 
 #include <zlib.h>
 #include "absl/container/flat_hash_map.h"
@@ -153,6 +193,206 @@ public:
 static DisassemblyListener *disassembly_listener = nullptr;
 #endif
 
+////////////////////////////////////////////////////////////////////////////////
+// PERF SUPPORT
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+    setting SCOPES_PERF to a list containing `map` appends the address, size
+    and name of every JIT compiled function to /tmp/perf-<pid>.map, which
+    perf report uses to symbolize samples. `jitdump` writes the functions
+    along with their code to /tmp/jit-<pid>.dump, which `perf inject --jit`
+    merges into a recording made with `perf record -k 1`, so that the code
+    can be annotated as well. when LLVM was built with perf support, its own
+    jitdump writer is used instead, which also records line tables. both see
+    cached objects, which are loaded through the same object layer.
+*/
+
+#ifdef SCOPES_LINUX
+class PerfListener : public llvm::JITEventListener {
+public:
+    FILE *map_file = nullptr;
+    FILE *dump_file = nullptr;
+    uint64_t code_index = 0;
+
+    enum {
+        JITDUMP_MAGIC = 0x4A695444,
+        JITDUMP_VERSION = 1,
+        JIT_CODE_LOAD = 0,
+    };
+
+    struct DumpHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t total_size;
+        uint32_t elf_mach;
+        uint32_t pad1;
+        uint32_t pid;
+        uint64_t timestamp;
+        uint64_t flags;
+    };
+
+    struct CodeLoadRecord {
+        uint32_t id;
+        uint32_t total_size;
+        uint64_t timestamp;
+        uint32_t pid;
+        uint32_t tid;
+        uint64_t vma;
+        uint64_t code_addr;
+        uint64_t code_size;
+        uint64_t code_index;
+    };
+
+    static uint64_t timestamp() {
+        // perf record -k 1 samples the same clock
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    }
+
+    bool open_map() {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/perf-%i.map", (int)getpid());
+        map_file = fopen(path, "a");
+        if (!map_file) {
+            printf("failed to open %s (%s)\n", path, strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    bool open_dump() {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/jit-%i.dump", (int)getpid());
+        dump_file = fopen(path, "w+");
+        if (!dump_file) {
+            printf("failed to open %s (%s)\n", path, strerror(errno));
+            return false;
+        }
+        // perf finds the dump through this executable mapping of it
+        void *marker = mmap(nullptr, sysconf(_SC_PAGESIZE),
+            PROT_READ | PROT_EXEC, MAP_PRIVATE, fileno(dump_file), 0);
+        if (marker == MAP_FAILED) {
+            printf("failed to map %s (%s)\n", path, strerror(errno));
+            fclose(dump_file);
+            dump_file = nullptr;
+            return false;
+        }
+        DumpHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = JITDUMP_MAGIC;
+        header.version = JITDUMP_VERSION;
+        header.total_size = sizeof(header);
+    #if defined(__x86_64__)
+        header.elf_mach = llvm::ELF::EM_X86_64;
+    #elif defined(__aarch64__)
+        header.elf_mach = llvm::ELF::EM_AARCH64;
+    #elif defined(__riscv)
+        header.elf_mach = llvm::ELF::EM_RISCV;
+    #endif
+        header.pid = getpid();
+        header.timestamp = timestamp();
+        fwrite(&header, sizeof(header), 1, dump_file);
+        fflush(dump_file);
+        return true;
+    }
+
+    void write_function(const std::string &name, uint64_t addr, uint64_t size) {
+        if (map_file) {
+            fprintf(map_file, "%llx %llx %s\n", (unsigned long long)addr,
+                (unsigned long long)size, name.c_str());
+        }
+        if (dump_file) {
+            CodeLoadRecord rec;
+            rec.id = JIT_CODE_LOAD;
+            rec.total_size = sizeof(rec) + name.size() + 1 + size;
+            rec.timestamp = timestamp();
+            rec.pid = getpid();
+            rec.tid = syscall(SYS_gettid);
+            rec.vma = addr;
+            rec.code_addr = addr;
+            rec.code_size = size;
+            rec.code_index = code_index++;
+            fwrite(&rec, sizeof(rec), 1, dump_file);
+            fwrite(name.c_str(), name.size() + 1, 1, dump_file);
+            fwrite((const void *)addr, size, 1, dump_file);
+        }
+    }
+
+    virtual void notifyObjectLoaded(
+        ObjectKey K,
+        const llvm::object::ObjectFile &Obj,
+        const llvm::RuntimeDyld::LoadedObjectInfo &L) {
+        // a copy of the object whose sections have their load addresses
+        auto debug_obj = L.getObjectForDebug(Obj);
+        if (!debug_obj.getBinary())
+            return;
+        for (auto &S : llvm::object::computeSymbolSizes(*debug_obj.getBinary())) {
+            llvm::object::SymbolRef sym = S.first;
+            auto type = sym.getType();
+            if (!type) {
+                llvm::consumeError(type.takeError());
+                continue;
+            }
+            if (*type != llvm::object::SymbolRef::ST_Function)
+                continue;
+            auto name = sym.getName();
+            if (!name) {
+                llvm::consumeError(name.takeError());
+                continue;
+            }
+            auto addr = sym.getAddress();
+            if (!addr) {
+                llvm::consumeError(addr.takeError());
+                continue;
+            }
+            if (!S.second)
+                continue;
+            write_function(name->str(), *addr, S.second);
+        }
+        if (map_file)
+            fflush(map_file);
+        if (dump_file)
+            fflush(dump_file);
+    }
+};
+
+static PerfListener *perf_listener = nullptr;
+// null unless LLVM was built with LLVM_USE_PERF
+static llvm::JITEventListener *llvm_perf_listener = nullptr;
+
+static void init_perf_listener() {
+    const char *mode = getenv("SCOPES_PERF");
+    if (!mode || !*mode)
+        return;
+    bool want_map = strstr(mode, "map");
+    bool want_dump = strstr(mode, "jitdump");
+    if (!want_map && !want_dump) {
+        printf("SCOPES_PERF must contain map or jitdump\n");
+        return;
+    }
+    if (want_dump) {
+        llvm_perf_listener = llvm::JITEventListener::createPerfJITEventListener();
+        if (llvm_perf_listener)
+            want_dump = false;
+    }
+    if (!want_map && !want_dump)
+        return;
+    auto listener = new PerfListener();
+    bool ok = true;
+    if (want_map)
+        ok = ok && listener->open_map();
+    if (want_dump)
+        ok = ok && listener->open_dump();
+    if (!ok) {
+        delete listener;
+        return;
+    }
+    perf_listener = listener;
+}
+#endif
+
 void enable_disassembly(bool enable) {
 #if SCOPES_LLVM_SUPPORT_DISASSEMBLY
     assert(disassembly_listener);
@@ -179,7 +419,126 @@ void print_disassembly(std::string symbol, void *pfunc) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void build_and_run_opt_passes(LLVMModuleRef module, int opt_level) {
+////////////////////////////////////////////////////////////////////////////////
+// VECTOR MATH LIBRARY
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+    glibc's libmvec provides SIMD variants of the libm functions, named after
+    the x86_64 vector function ABI as _ZGV<isa>N<lanes><args>_<name>, where isa
+    is b (SSE), d (AVX2) or e (AVX-512). we describe them to the loop and SLP
+    vectorizers through the target library info; a variant is only offered
+    when the target machine has its instruction set and the running process
+    can resolve its symbol, so the JIT can link it. objects built with
+    compile-object must then be linked against libmvec (-lmvec). loops that
+    don't vectorize, and all other targets, keep calling the scalar functions.
+*/
+
+namespace {
+struct VectorMathFunction {
+    std::string scalar;
+    std::string vector;
+    unsigned lanes;
+    char isa;
+};
+} // namespace
+
+static std::vector<VectorMathFunction> vector_math_functions;
+
+static void init_vector_math_library() {
+#ifdef SCOPES_LINUX
+    static bool initialized = false;
+    if (initialized)
+        return;
+    initialized = true;
+    // loaded globally, so that the JIT's process symbol search finds it
+    void *libmvec = dlopen("libmvec.so.1", RTLD_NOW | RTLD_GLOBAL);
+    if (!libmvec)
+        return;
+    static const struct {
+        const char *name;
+        // name of the LLVM intrinsic that is generated instead, if any
+        const char *intrinsic;
+        int argcount;
+    } functions[] = {
+        { "sin", "llvm.sin", 1 },
+        { "cos", "llvm.cos", 1 },
+        { "tan", nullptr, 1 },
+        { "asin", nullptr, 1 },
+        { "acos", nullptr, 1 },
+        { "atan", nullptr, 1 },
+        { "atan2", nullptr, 2 },
+        { "sinh", nullptr, 1 },
+        { "cosh", nullptr, 1 },
+        { "tanh", nullptr, 1 },
+        { "asinh", nullptr, 1 },
+        { "acosh", nullptr, 1 },
+        { "atanh", nullptr, 1 },
+        { "exp", "llvm.exp", 1 },
+        { "log", "llvm.log", 1 },
+        { "exp2", "llvm.exp2", 1 },
+        { "log2", "llvm.log2", 1 },
+        { "pow", "llvm.pow", 2 },
+    };
+    static const struct {
+        char isa;
+        unsigned bits;
+    } isas[] = { { 'b', 128 }, { 'd', 256 }, { 'e', 512 } };
+    for (auto &f : functions) {
+        for (auto &isa : isas) {
+            for (int single = 0; single < 2; ++single) {
+                std::string scalar = f.name;
+                if (single)
+                    scalar += "f";
+                unsigned lanes = isa.bits / (single?32:64);
+                std::string vector = std::string("_ZGV") + isa.isa + "N"
+                    + std::to_string(lanes) + std::string(f.argcount, 'v')
+                    + "_" + scalar;
+                // older versions of glibc only provide some of them
+                if (!dlsym(libmvec, vector.c_str()))
+                    continue;
+                vector_math_functions.push_back({ scalar, vector, lanes, isa.isa });
+                if (f.intrinsic) {
+                    vector_math_functions.push_back({
+                        std::string(f.intrinsic) + (single?".f32":".f64"),
+                        vector, lanes, isa.isa });
+                }
+            }
+        }
+    }
+#endif
+}
+
+static llvm::TargetLibraryInfoImpl *create_target_library_info(
+    LLVMTargetMachineRef tm) {
+    char *triplestr = LLVMGetTargetMachineTriple(tm);
+    llvm::Triple triple(triplestr);
+    LLVMDisposeMessage(triplestr);
+    auto tli = new llvm::TargetLibraryInfoImpl(triple);
+    if ((triple.getArch() != llvm::Triple::x86_64)
+        || !triple.isOSLinux() || !triple.isGNUEnvironment())
+        return tli;
+    init_vector_math_library();
+    char *featurestr = LLVMGetTargetMachineFeatureString(tm);
+    std::string features = featurestr;
+    LLVMDisposeMessage(featurestr);
+    bool avx2 = (features.find("+avx2") != std::string::npos);
+    bool avx512 = (features.find("+avx512f") != std::string::npos);
+    std::vector<llvm::VecDesc> descs;
+    for (auto &f : vector_math_functions) {
+        if (((f.isa == 'd') && !avx2) || ((f.isa == 'e') && !avx512))
+            continue;
+        descs.push_back({ f.scalar, f.vector,
+            llvm::ElementCount::getFixed(f.lanes) });
+    }
+    tli->addVectorizableFunctions(descs);
+    return tli;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void build_and_run_opt_passes(LLVMModuleRef module, int opt_level,
+    LLVMTargetMachineRef tm) {
     LLVMPassManagerBuilderRef passBuilder;
 
     passBuilder = LLVMPassManagerBuilderCreate();
@@ -194,16 +553,33 @@ void build_and_run_opt_passes(LLVMModuleRef module, int opt_level) {
         LLVMPassManagerBuilderUseInlinerWithThreshold(passBuilder, 225);
     }
     #endif
+    if (tm) {
+        // the builder takes ownership
+        reinterpret_cast<llvm::PassManagerBuilder *>(passBuilder)->LibraryInfo =
+            create_target_library_info(tm);
+    }
 
     LLVMPassManagerRef functionPasses =
       LLVMCreateFunctionPassManagerForModule(module);
     LLVMPassManagerRef modulePasses =
       LLVMCreatePassManager();
-    //LLVMAddAnalysisPasses(LLVMGetExecutionEngineTargetMachine(ee), functionPasses);
+    if (tm) {
+        // without the target's cost model, the vectorizers assume that
+        // there are no vector registers
+        LLVMAddAnalysisPasses(tm, functionPasses);
+        LLVMAddAnalysisPasses(tm, modulePasses);
+    }
 
     LLVMPassManagerBuilderPopulateFunctionPassManager(passBuilder,
                                                       functionPasses);
     LLVMPassManagerBuilderPopulateModulePassManager(passBuilder, modulePasses);
+#if LLVM_VERSION_MAJOR < 16
+    if (opt_level >= 2) {
+        // move cold regions (blocks that end in unreachable, call cold
+        // functions or are cold in the input profile) out of hot functions
+        llvm::unwrap(modulePasses)->add(llvm::createHotColdSplittingPass());
+    }
+#endif
 
     LLVMPassManagerBuilderDispose(passBuilder);
     if (opt_level == 0) {
@@ -223,6 +599,376 @@ void build_and_run_opt_passes(LLVMModuleRef module, int opt_level) {
     LLVMDisposePassManager(modulePasses);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// THINLTO
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+    modules compiled with the thin-lto flag, and C modules imported with
+    `-c <name>.bc`, are written as bitcode with a module summary. the link
+    step reads such files, imports functions across module boundaries where
+    the summaries suggest it, typically small accessors, then optimizes and
+    generates every module on its own thread. module n is written to
+    <path without extension>.<n><ext>; bitcode without a summary is merged
+    into a single regular LTO module, which is written as module 0.
+
+    since the final link happens elsewhere, every symbol is kept visible.
+*/
+
+SCOPES_RESULT(void) write_summary_bitcode(LLVMModuleRef module, const char *path) {
+    SCOPES_RESULT_TYPE(void);
+    auto &M = *llvm::unwrap(module);
+    std::error_code ec;
+    llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::OF_None);
+    if (ec) {
+        SCOPES_ERROR(CGenBackendFailed,
+            strdup((path + std::string(": ") + ec.message()).c_str()));
+    }
+    llvm::ProfileSummaryInfo PSI(M);
+    auto index = llvm::buildModuleSummaryIndex(M, nullptr, &PSI);
+    llvm::WriteBitcodeToFile(M, os, false, &index);
+    return {};
+}
+
+SCOPES_RESULT(void) thin_lto_link(const char *triple,
+    const std::vector<std::string> &inputs, const char *path, int opt_level) {
+    SCOPES_RESULT_TYPE(void);
+    llvm::lto::Config conf;
+    conf.DefaultTriple = triple;
+    conf.OptLevel = opt_level;
+    conf.RelocModel = llvm::Reloc::PIC_;
+    llvm::lto::LTO lto(std::move(conf), llvm::lto::createInProcessThinBackend(
+        llvm::heavyweight_hardware_concurrency()));
+
+    std::vector<std::unique_ptr<llvm::MemoryBuffer>> buffers;
+    std::unordered_set<std::string> defined;
+    for (auto &input : inputs) {
+        auto buffer = llvm::MemoryBuffer::getFile(input);
+        if (!buffer) {
+            SCOPES_ERROR(CGenBackendFailed, strdup(
+                (input + ": " + buffer.getError().message()).c_str()));
+        }
+        auto file = llvm::lto::InputFile::create((*buffer)->getMemBufferRef());
+        if (!file) {
+            SCOPES_ERROR(CGenBackendFailed, strdup(
+                (input + ": " + llvm::toString(file.takeError())).c_str()));
+        }
+        buffers.push_back(std::move(*buffer));
+        std::vector<llvm::lto::SymbolResolution> resolutions;
+        for (auto &sym : (*file)->symbols()) {
+            llvm::lto::SymbolResolution res;
+            if (!sym.isUndefined()) {
+                // the first definition wins
+                res.Prevailing = defined.insert(sym.getName().str()).second;
+            }
+            res.VisibleToRegularObj = true;
+            resolutions.push_back(res);
+        }
+        if (auto err = lto.add(std::move(*file), resolutions)) {
+            SCOPES_ERROR(CGenBackendFailed, strdup(
+                (input + ": " + llvm::toString(std::move(err))).c_str()));
+        }
+    }
+
+    std::string stem = path;
+    std::string ext;
+    auto dot = stem.rfind('.');
+    auto slash = stem.find_last_of("/\\");
+    if ((dot != std::string::npos)
+        && ((slash == std::string::npos) || (dot > slash))) {
+        ext = stem.substr(dot);
+        stem = stem.substr(0, dot);
+    }
+    // a failed stream must not reach the backend, whose destructor of a
+    // raw_fd_ostream with an error would abort the process
+    auto open_output = [&](unsigned task)
+        -> llvm::Expected<std::unique_ptr<llvm::raw_pwrite_stream>> {
+        auto filename = stem + "." + std::to_string(task) + ext;
+        std::error_code ec;
+        auto os = std::make_unique<llvm::raw_fd_ostream>(filename, ec,
+            llvm::sys::fs::OF_None);
+        if (ec) {
+            return llvm::createStringError(ec, filename + ": " + ec.message());
+        }
+        return std::move(os);
+    };
+#if LLVM_VERSION_MAJOR >= 14
+#if LLVM_VERSION_MAJOR >= 15
+    auto add_stream = [&](unsigned task, const llvm::Twine &)
+#else
+    auto add_stream = [&](unsigned task)
+#endif
+        -> llvm::Expected<std::unique_ptr<llvm::CachedFileStream>> {
+        auto os = open_output(task);
+        if (!os)
+            return os.takeError();
+        return std::make_unique<llvm::CachedFileStream>(std::move(*os));
+    };
+#else
+    // streams can't fail here; the backend writes into a null stream and the
+    // first error is reported after the run
+    std::mutex error_lock;
+    std::string error;
+    auto add_stream = [&](unsigned task) {
+        auto os = open_output(task);
+        if (!os) {
+            std::lock_guard<std::mutex> guard(error_lock);
+            if (error.empty())
+                error = llvm::toString(os.takeError());
+            else
+                llvm::consumeError(os.takeError());
+            return std::make_unique<llvm::lto::NativeObjectStream>(
+                std::make_unique<llvm::raw_null_ostream>());
+        }
+        return std::make_unique<llvm::lto::NativeObjectStream>(std::move(*os));
+    };
+#endif
+    if (auto err = lto.run(add_stream)) {
+        SCOPES_ERROR(CGenBackendFailed,
+            strdup(llvm::toString(std::move(err)).c_str()));
+    }
+#if LLVM_VERSION_MAJOR < 14
+    if (!error.empty()) {
+        SCOPES_ERROR(CGenBackendFailed, strdup(error.c_str()));
+    }
+#endif
+    return {};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PROFILE GUIDED OPTIMIZATION
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+    instrumentation and profile use both run on the unoptimized module, right
+    after generation, so that the CFG hashes computed by the instrumenting pass
+    match the ones the using pass computes in a later session.
+
+    the profile runtime from compiler-rt can not see counters that live in
+    JIT memory, so for JIT modules we keep our own registry of counter arrays
+    and write the indexed profile ourselves. objects built with
+    compile-object are instrumented the standard way and must be linked with
+    the profile runtime (e.g. clang -fprofile-generate).
+
+    a profiled JIT module generates all of its functions anew, rather than
+    calling versions that were compiled without instrumentation or profile,
+    and renames them afterwards so they don't clash with those.
+*/
+
+namespace {
+struct ProfileRecord {
+    std::string name;
+    uint64_t hash;
+    uint32_t num_counters;
+    uint32_t num_value_sites[llvm::IPVK_Last + 1];
+    // JIT symbol of a pointer to the counter array
+    std::string symbol;
+    const uint64_t *counters;
+};
+} // namespace
+
+static std::vector<ProfileRecord> profile_records;
+static std::string profile_input_path;
+
+SCOPES_RESULT(void) set_profile_input(const char *path) {
+    SCOPES_RESULT_TYPE(void);
+    auto reader = llvm::IndexedInstrProfReader::create(path);
+    if (!reader) {
+        SCOPES_ERROR(CGenProfileFailed, String::from_stdstring(
+            path + std::string(": ") + llvm::toString(reader.takeError())));
+    }
+    if (!(*reader)->isIRLevelProfile()) {
+        SCOPES_ERROR(CGenProfileFailed, String::from_stdstring(
+            path + std::string(": not an IR level instrumentation profile")));
+    }
+    profile_input_path = path;
+    return {};
+}
+
+static void collect_profile_records(llvm::Module &M,
+    std::vector<ProfileRecord> &records) {
+    std::vector<llvm::Instruction *> value_sites;
+    for (auto &F : M) {
+        value_sites.clear();
+        ProfileRecord *record = nullptr;
+        size_t first = records.size();
+        for (auto &BB : F) {
+            for (auto &I : BB) {
+                if (auto inc = llvm::dyn_cast<llvm::InstrProfIncrementInst>(&I)) {
+                    if (!record) {
+                        records.push_back({});
+                        record = &records.back();
+                        record->name = llvm::getPGOFuncNameVarInitializer(
+                            inc->getName()).str();
+                        record->hash = inc->getHash()->getZExtValue();
+                        record->num_counters =
+                            inc->getNumCounters()->getZExtValue();
+                        // reuse the name variable suffix to find the counters
+                        // once the intrinsics have been lowered
+                        record->symbol = inc->getName()->getName().substr(
+                            llvm::getInstrProfNameVarPrefix().size()).str();
+                        record->counters = nullptr;
+                    }
+                } else if (auto vp =
+                    llvm::dyn_cast<llvm::InstrProfValueProfileInst>(&I)) {
+                    // value profiling needs the compiler-rt runtime; keep
+                    // the number of sites so profile use stays consistent
+                    value_sites.push_back(vp);
+                }
+            }
+        }
+        if (!record)
+            continue;
+        for (auto vp : value_sites) {
+            auto inst = llvm::cast<llvm::InstrProfValueProfileInst>(vp);
+            auto kind = inst->getValueKind()->getZExtValue();
+            auto index = inst->getIndex()->getZExtValue();
+            assert(kind <= llvm::IPVK_Last);
+            auto &count = records[first].num_value_sites[kind];
+            count = std::max(count, (uint32_t)(index + 1));
+            vp->eraseFromParent();
+        }
+    }
+}
+
+static void export_profile_counters(llvm::Module &M,
+    std::vector<ProfileRecord> &records, size_t first) {
+    static int counter = 0;
+    for (size_t i = first; i < records.size(); ++i) {
+        auto &record = records[i];
+        auto prefix = llvm::getInstrProfCountersVarPrefix().str();
+        auto counters = M.getNamedGlobal(prefix + record.symbol);
+        if (!counters) {
+            counters = M.getNamedGlobal(prefix + record.symbol
+                + "." + std::to_string(record.hash));
+        }
+        assert(counters);
+        record.symbol = "__scopes_profc_" + std::to_string(counter++);
+        new llvm::GlobalVariable(M, counters->getType(), true,
+            llvm::GlobalValue::ExternalLinkage, counters, record.symbol);
+    }
+    // the runtime is not linked into the JIT; drop the hooks that reference it
+    if (auto F = M.getFunction(llvm::getInstrProfRuntimeHookVarUseFuncName())) {
+        F->eraseFromParent();
+    }
+    if (auto G = M.getNamedGlobal(llvm::getInstrProfRuntimeHookVarName())) {
+        if (G->use_empty())
+            G->eraseFromParent();
+    }
+    // every module defines the version variable; keep it private
+    if (auto G = M.getNamedGlobal(INSTR_PROF_QUOTE(INSTR_PROF_RAW_VERSION_VAR))) {
+        G->setComdat(nullptr);
+        G->setLinkage(llvm::GlobalValue::PrivateLinkage);
+    }
+}
+
+SCOPES_RESULT(void) run_profile_passes(LLVMModuleRef module,
+    uint64_t compiler_flags, bool jit) {
+    SCOPES_RESULT_TYPE(void);
+    auto &M = *llvm::unwrap(module);
+    if (compiler_flags & CF_ProfileGenerate) {
+        {
+            llvm::legacy::PassManager pm;
+            pm.add(llvm::createPGOInstrumentationGenLegacyPass());
+            pm.run(M);
+        }
+        size_t first = profile_records.size();
+        if (jit) {
+            collect_profile_records(M, profile_records);
+        }
+        {
+            llvm::legacy::PassManager pm;
+            pm.add(llvm::createInstrProfilingLegacyPass());
+            pm.run(M);
+        }
+        if (jit) {
+            export_profile_counters(M, profile_records, first);
+        }
+    } else if (compiler_flags & CF_ProfileUse) {
+        if (profile_input_path.empty()) {
+            SCOPES_ERROR(CGenProfileInputMissing);
+        }
+        llvm::legacy::PassManager pm;
+        pm.add(llvm::createPGOInstrumentationUseLegacyPass(profile_input_path));
+        pm.run(M);
+    }
+    return {};
+}
+
+static SCOPES_RESULT(const uint64_t *) get_profile_counters(ProfileRecord &record) {
+    SCOPES_RESULT_TYPE(const uint64_t *);
+    if (!record.counters) {
+        auto addr = SCOPES_GET_RESULT(get_address(record.symbol.c_str()));
+        record.counters = *(const uint64_t **)addr;
+    }
+    return record.counters;
+}
+
+SCOPES_RESULT(void) write_profile(const char *path) {
+    SCOPES_RESULT_TYPE(void);
+    llvm::InstrProfWriter writer;
+#if LLVM_VERSION_MAJOR >= 14
+    if (auto E = writer.mergeProfileKind(llvm::InstrProfKind::IR)) {
+        llvm::consumeError(std::move(E));
+    }
+#else
+    writer.setIsIRLevelProfile(true, false);
+#endif
+    for (auto &record : profile_records) {
+        auto counters = SCOPES_GET_RESULT(get_profile_counters(record));
+        llvm::NamedInstrProfRecord rec(record.name, record.hash,
+            std::vector<uint64_t>(counters, counters + record.num_counters));
+        for (uint32_t kind = 0; kind <= llvm::IPVK_Last; ++kind) {
+            for (uint32_t i = 0; i < record.num_value_sites[kind]; ++i) {
+                rec.addValueData(kind, i, nullptr, 0, nullptr);
+            }
+        }
+        writer.addRecord(std::move(rec), [](llvm::Error E) {
+            llvm::consumeError(std::move(E));
+        });
+    }
+    std::error_code EC;
+    llvm::raw_fd_ostream os(path, EC, llvm::sys::fs::OF_None);
+    if (EC) {
+        SCOPES_ERROR(CGenProfileFailed, String::from_stdstring(
+            path + std::string(": ") + EC.message()));
+    }
+    if (auto E = writer.write(os)) {
+        SCOPES_ERROR(CGenProfileFailed, String::from_stdstring(
+            path + std::string(": ") + llvm::toString(std::move(E))));
+    }
+    return {};
+}
+
+SCOPES_RESULT(void) reset_profile() {
+    SCOPES_RESULT_TYPE(void);
+    for (auto &record : profile_records) {
+        auto counters = SCOPES_GET_RESULT(get_profile_counters(record));
+        memset((void *)counters, 0, sizeof(uint64_t) * record.num_counters);
+    }
+    return {};
+}
+
+uint64_t get_function_entry_count(LLVMValueRef func) {
+    auto F = llvm::unwrap<llvm::Function>(func);
+    if (auto count = F->getEntryCount())
+        return count->getCount();
+    return 0;
+}
+
+static absl::flat_hash_map<const void *, uint64_t> profile_entry_counts;
+
+void set_profile_entry_count(const void *ptr, uint64_t count) {
+    profile_entry_counts[ptr] = count;
+}
+
+uint64_t get_profile_entry_count(const void *ptr) {
+    auto it = profile_entry_counts.find(ptr);
+    if (it == profile_entry_counts.end())
+        return 0;
+    return it->second;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 static void *global_c_namespace = nullptr;
@@ -246,12 +992,28 @@ const String *get_default_target_triple() {
   LLVMDisposeMessage. */
 //char* LLVMNormalizeTargetTriple(const char* triple);
 
+static LLVMOrcJITDylibRef batch_dylib = nullptr;
+
 SCOPES_RESULT(uint64_t) get_address(const char *name) {
     SCOPES_RESULT_TYPE(uint64_t);
     LLVMOrcJITTargetAddress addr = 0;
-    auto err = LLVMOrcLLJITLookup(orc, &addr, name);
-    if (err) {
-        SCOPES_ERROR(ExecutionEngineFailed, LLVMGetErrorMessage(err));
+    if (batch_dylib) {
+        // globals of batched modules are only defined in the batch dylib
+        auto &J = *reinterpret_cast<llvm::orc::LLJIT *>(orc);
+        llvm::orc::JITDylib *order[] = { &J.getMainJITDylib(),
+            reinterpret_cast<llvm::orc::JITDylib *>(batch_dylib) };
+        auto sym = J.getExecutionSession().lookup(order,
+            J.mangleAndIntern(name));
+        if (!sym) {
+            SCOPES_ERROR(ExecutionEngineFailed,
+                strdup(llvm::toString(sym.takeError()).c_str()));
+        }
+        addr = sym->getAddress();
+    } else {
+        auto err = LLVMOrcLLJITLookup(orc, &addr, name);
+        if (err) {
+            SCOPES_ERROR(ExecutionEngineFailed, LLVMGetErrorMessage(err));
+        }
     }
     if (!addr) {
         SCOPES_ERROR(RTGetAddressFailed, Symbol(String::from_cstr(name)));
@@ -358,6 +1120,17 @@ static LLVMOrcObjectLayerRef llvm_create_object_layer(
 
     object_layer = LLVMOrcCreateRTDyldObjectLinkingLayerWithSectionMemoryManager(ES);
     LLVMOrcRTDyldObjectLinkingLayerRegisterJITEventListener(object_layer, LLVMCreateGDBRegistrationListener());
+#ifdef SCOPES_LINUX
+    if (perf_listener) {
+        llvm::JITEventListener *le = perf_listener;
+        LLVMOrcRTDyldObjectLinkingLayerRegisterJITEventListener(object_layer,
+            llvm::wrap(le));
+    }
+    if (llvm_perf_listener) {
+        LLVMOrcRTDyldObjectLinkingLayerRegisterJITEventListener(object_layer,
+            llvm::wrap(llvm_perf_listener));
+    }
+#endif
 
 #if SCOPES_LLVM_SUPPORT_DISASSEMBLY
     if (!disassembly_listener) {
@@ -420,6 +1193,10 @@ SCOPES_RESULT(void) init_execution() {
         optlevel, reloc, codemodel);
     assert(jtm);
 
+#ifdef SCOPES_LINUX
+    init_perf_listener();
+#endif
+
     auto builder = LLVMOrcCreateLLJITBuilder();
     auto tmb = LLVMOrcJITTargetMachineBuilderCreateFromTargetMachine(jtm);
     LLVMOrcLLJITBuilderSetJITTargetMachineBuilder(builder, tmb);
@@ -453,8 +1230,6 @@ SCOPES_RESULT(void) init_execution() {
     return {};
 }
 
-static std::vector<const PointerMap *> pointer_maps;
-
 static LLVMMemoryBufferRef module_to_membuffer(LLVMModuleRef module) {
     LLVMMemoryBufferRef irbuf = nullptr;
 #if SCOPES_CACHE_KEY_BITCODE
@@ -468,11 +1243,246 @@ static LLVMMemoryBufferRef module_to_membuffer(LLVMModuleRef module) {
     return irbuf;
 }
 
-SCOPES_RESULT(void) add_module(LLVMModuleRef module, const PointerMap &map,
-    uint64_t compiler_flags) {
+static llvm::orc::LLJIT &unwrap_jit() {
+    return *reinterpret_cast<llvm::orc::LLJIT *>(orc);
+}
+
+static llvm::orc::JITDylib &unwrap_dylib(LLVMOrcJITDylibRef dylib) {
+    return *reinterpret_cast<llvm::orc::JITDylib *>(dylib);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// UNITS
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+    every module added to the JIT, and every batch, is a unit with its own
+    resource trackers, so that its code, data and pointer map can be removed
+    again. compile() registers the function it returns as an entry of its
+    unit. once all entries have been released, the unit is dead unless a
+    live unit refers to one of its symbols, and the next collection unloads
+    it. releasing a function asserts that neither the function nor any
+    pointer obtained through it is still in use. a unit that hands out the
+    address of one of its functions or globals, constant or not, or that
+    defines global variables, is never unloaded, since we can't know who
+    still holds on to them; the result of a stage may well point into it.
+*/
+
+struct JITUnit {
+    // stubs, pointer maps and the code of unbatched modules
+    llvm::orc::ResourceTrackerSP main_tracker;
+    // code of batched modules
+    llvm::orc::ResourceTrackerSP batch_tracker;
+    std::vector<const PointerMap *> maps;
+    std::vector<std::string> defines;
+    std::vector<std::string> references;
+    std::vector<const void *> addresses;
+    std::vector<const void *> entries;
+    int live_entries = 0;
+    // profile counters are read after the fact; handed out function
+    // addresses and global variables may be used after the last entry
+    bool pinned = false;
+    // the batch has not been emitted yet
+    bool pending = false;
+    bool marked = false;
+};
+
+static std::vector<JITUnit *> jit_units;
+static absl::flat_hash_map<std::string, JITUnit *> symbol_units;
+static absl::flat_hash_map<const void *, int> entry_counts;
+
+static JITUnit *new_unit(uint64_t compiler_flags) {
+    auto unit = new JITUnit();
+    unit->main_tracker = unwrap_dylib(jit_dylib).createResourceTracker();
+    unit->pinned = (compiler_flags & CF_ProfileGenerate);
+    jit_units.push_back(unit);
+    return unit;
+}
+
+// whether value is used as anything but the callee of a call or the
+// address of a load, looking through constant casts and offsets
+static bool is_address_taken(LLVMValueRef value) {
+    for (LLVMUseRef use = LLVMGetFirstUse(value); use; use = LLVMGetNextUse(use)) {
+        LLVMValueRef user = LLVMGetUser(use);
+        if (LLVMIsALoadInst(user))
+            continue;
+        if (LLVMIsACallInst(user)) {
+            if (LLVMGetCalledValue(user) != value)
+                return true;
+        } else if (!LLVMIsAConstantExpr(user) || is_address_taken(user)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// records what module defines and references in unit, without registering
+// the definitions
+static void collect_unit_symbols(JITUnit *unit, LLVMModuleRef module) {
+    auto add = [&](LLVMValueRef value) {
+        size_t length = 0;
+        const char *name = LLVMGetValueName2(value, &length);
+        if (!length || !strncmp(name, "llvm.", 5))
+            return;
+        if (LLVMIsDeclaration(value)) {
+            unit->references.push_back(std::string(name, length));
+            return;
+        }
+        if (is_address_taken(value)) {
+            unit->pinned = true;
+        } else if (!LLVMIsAFunction(value) && !LLVMIsGlobalConstant(value)) {
+            unit->pinned = true;
+        }
+        if (LLVMGetLinkage(value) == LLVMExternalLinkage) {
+            unit->defines.push_back(std::string(name, length));
+        }
+    };
+    for (LLVMValueRef value = LLVMGetFirstFunction(module);
+        value; value = LLVMGetNextFunction(value)) {
+        add(value);
+    }
+    for (LLVMValueRef value = LLVMGetFirstGlobal(module);
+        value; value = LLVMGetNextGlobal(value)) {
+        add(value);
+    }
+}
+
+static void add_unit_symbols(JITUnit *unit, LLVMModuleRef module) {
+    auto first = unit->defines.size();
+    collect_unit_symbols(unit, module);
+    for (size_t i = first; i < unit->defines.size(); ++i) {
+        symbol_units[unit->defines[i]] = unit;
+    }
+}
+
+static SCOPES_RESULT(void) define_pointer_map(JITUnit *unit, const PointerMap &map) {
+    SCOPES_RESULT_TYPE(void);
+    auto ptrmap = new PointerMap(map);
+    unit->maps.push_back(ptrmap);
+    auto &ES = unwrap_jit().getExecutionSession();
+    llvm::orc::SymbolMap symbols;
+    for (auto it = ptrmap->begin(); it != ptrmap->end(); ++it) {
+        symbols[ES.intern(it->first)] = llvm::JITEvaluatedSymbol(
+            llvm::pointerToJITTargetAddress(it->second),
+            llvm::JITSymbolFlags::Exported);
+    }
+    if (auto err = unwrap_dylib(jit_dylib).define(
+        llvm::orc::absoluteSymbols(std::move(symbols)), unit->main_tracker)) {
+        SCOPES_ERROR(ExecutionEngineFailed,
+            strdup(llvm::toString(std::move(err)).c_str()));
+    }
+    return {};
+}
+
+void track_compiled_symbol(const char *name, const void *ptr, bool entry) {
+    auto it = symbol_units.find(name);
+    if (it == symbol_units.end())
+        return;
+    auto unit = it->second;
+    unit->addresses.push_back(ptr);
+    if (entry) {
+        unit->live_entries++;
+        unit->entries.push_back(ptr);
+        entry_counts[ptr]++;
+    }
+}
+
+SCOPES_RESULT(void) release_compiled_function(const void *ptr) {
+    SCOPES_RESULT_TYPE(void);
+    auto it = entry_counts.find(ptr);
+    if ((it == entry_counts.end()) || !it->second) {
+        SCOPES_ERROR(ExecutionEngineFailed,
+            "pointer does not refer to a live compiled function");
+    }
+    it->second--;
+    for (auto unit : jit_units) {
+        if (std::find(unit->entries.begin(), unit->entries.end(), ptr)
+            != unit->entries.end()) {
+            unit->live_entries--;
+            break;
+        }
+    }
+    return {};
+}
+
+static void mark_unit(JITUnit *unit, std::vector<JITUnit *> &stack) {
+    if (unit->marked)
+        return;
+    unit->marked = true;
+    stack.push_back(unit);
+}
+
+SCOPES_RESULT(int) unload_dead_units(std::vector<std::string> &removed) {
+    SCOPES_RESULT_TYPE(int);
+    std::vector<JITUnit *> stack;
+    for (auto unit : jit_units) {
+        unit->marked = false;
+    }
+    for (auto unit : jit_units) {
+        if (unit->pinned || unit->pending || (unit->live_entries > 0)) {
+            mark_unit(unit, stack);
+        }
+    }
+    while (!stack.empty()) {
+        auto unit = stack.back();
+        stack.pop_back();
+        for (auto &name : unit->references) {
+            auto it = symbol_units.find(name);
+            if (it != symbol_units.end()) {
+                mark_unit(it->second, stack);
+            }
+        }
+    }
+    int count = 0;
+    size_t i = 0;
+    while (i < jit_units.size()) {
+        auto unit = jit_units[i];
+        if (unit->marked) {
+            i++;
+            continue;
+        }
+        jit_units.erase(jit_units.begin() + i);
+        if (unit->batch_tracker) {
+            if (auto err = unit->batch_tracker->remove()) {
+                SCOPES_ERROR(ExecutionEngineFailed,
+                    strdup(llvm::toString(std::move(err)).c_str()));
+            }
+        }
+        if (auto err = unit->main_tracker->remove()) {
+            SCOPES_ERROR(ExecutionEngineFailed,
+                strdup(llvm::toString(std::move(err)).c_str()));
+        }
+        for (auto &name : unit->defines) {
+            auto it = symbol_units.find(name);
+            if ((it != symbol_units.end()) && (it->second == unit)) {
+                symbol_units.erase(it);
+            }
+            removed.push_back(name);
+        }
+        for (auto ptr : unit->addresses) {
+            set_address_name(ptr, nullptr);
+        }
+        for (auto ptr : unit->entries) {
+            entry_counts.erase(ptr);
+        }
+        for (auto map : unit->maps) {
+            delete map;
+        }
+        delete unit;
+        count++;
+    }
+    return count;
+}
+
+// optimizes module, or finds it in the cache, and adds the object to the
+// dylib of tracker
+static SCOPES_RESULT(void) emit_module(const llvm::orc::ResourceTrackerSP &tracker,
+    LLVMModuleRef module, uint64_t compiler_flags) {
     SCOPES_RESULT_TYPE(void);
 #if SCOPES_ALLOW_CACHE
-    bool cache = ((compiler_flags & CF_Cache) == CF_Cache);
+    // instrumented or profile-optimized code must not end up in the cache
+    bool cache = ((compiler_flags & CF_Cache) == CF_Cache)
+        && !(compiler_flags & (CF_ProfileGenerate | CF_ProfileUse));
 #else
     const bool cache = false;
 #endif
@@ -526,25 +1536,6 @@ SCOPES_RESULT(void) add_module(LLVMModuleRef module, const PointerMap &map,
 
     LLVMErrorRef err = nullptr;
     //LLVMOrcModuleHandle newhandle = 0;
-    auto ptrmap = new PointerMap(map);
-    pointer_maps.push_back(ptrmap);
-    auto ES = LLVMOrcLLJITGetExecutionSession(orc);
-    std::vector<LLVMJITCSymbolMapPair> symbolpairs;
-    for (auto it = ptrmap->begin(); it != ptrmap->end(); ++it) {
-        const char *name = it->first.c_str();
-        void *ptr = const_cast< void *>(it->second);
-
-        LLVMJITCSymbolMapPair pair;
-        memset(&pair, 0, sizeof(pair));
-        pair.Name = LLVMOrcExecutionSessionIntern(ES, name);
-        pair.Sym.Address = (uint64_t)ptr;
-        symbolpairs.push_back(pair);
-    }
-    auto mu = LLVMOrcAbsoluteSymbols(symbolpairs.data(), symbolpairs.size());
-    err = LLVMOrcJITDylibDefine(jit_dylib, mu);
-    if (err) {
-        SCOPES_ERROR(ExecutionEngineFailed, LLVMGetErrorMessage(err));
-    }
 
     if (cache && filepath) {
         #if 0
@@ -583,7 +1574,8 @@ SCOPES_RESULT(void) add_module(LLVMModuleRef module, const PointerMap &map,
 
         #endif
 
-        err = LLVMOrcLLJITAddObjectFile(orc, jit_dylib, membuf);
+        err = LLVMOrcLLJITAddObjectFileWithRT(orc,
+            reinterpret_cast<LLVMOrcResourceTrackerRef>(tracker.get()), membuf);
         //err = LLVMOrcAddObjectFile(orc, &newhandle, membuf, orc_symbol_resolver, ptrmap);
         goto done;
     } else {
@@ -600,7 +1592,7 @@ skip_cache:
                 level = 2;
             else if ((compiler_flags & CF_O3) == CF_O3)
                 level = 3;
-            build_and_run_opt_passes(module, level);
+            build_and_run_opt_passes(module, level, get_jit_target_machine());
         }
 
         auto target_machine = get_jit_target_machine();
@@ -619,7 +1611,8 @@ skip_cache:
         }
 
         #if 1
-        err = LLVMOrcLLJITAddObjectFile(orc, jit_dylib, membuf);
+        err = LLVMOrcLLJITAddObjectFileWithRT(orc,
+            reinterpret_cast<LLVMOrcResourceTrackerRef>(tracker.get()), membuf);
         //err = LLVMOrcAddObjectFile(orc, &newhandle, membuf, orc_symbol_resolver, ptrmap);
         #else
         LLVMDisposeMemoryBuffer(membuf);
@@ -644,6 +1637,231 @@ done:
     return {};
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// BATCHING
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+    loading a module compiles many small functions, and each of them used to
+    become a module of its own, which was then optimized, emitted and added
+    to the JIT separately. batched functions are instead linked into a single
+    pending module, and the caller gets the address of a lazy stub. the first
+    call through any stub looks the function up in the batch dylib, which
+    emits the whole pending module as one object. a stage is compiled and then
+    immediately run, so a batch usually spans everything from one stage
+    boundary to the next.
+
+    stubs live in the main dylib and the batched definitions in a separate
+    one; each dylib links against the other, so batched code calls into
+    earlier modules directly and data defined in a batch stays visible.
+
+    a batch that is emitted from a stub has no caller to report an error to,
+    so compile() emits a module right away when one of its references can't
+    be resolved yet, and the stage runners flush the batch before they call
+    into it. batching is experimental and has to be enabled with
+    SCOPES_JIT_BATCH=1.
+*/
+
+static LLVMModuleRef batch_module = nullptr;
+static JITUnit *batch_unit = nullptr;
+static uint64_t batch_flags = 0;
+static std::unique_ptr<llvm::orc::LazyCallThroughManager> batch_call_manager;
+static std::unique_ptr<llvm::orc::IndirectStubsManager> batch_stubs_manager;
+
+// the error of the last emission that failed on behalf of a stub
+static std::string batch_error;
+
+SCOPES_RESULT(void) flush_batch() {
+    SCOPES_RESULT_TYPE(void);
+    if (!batch_module)
+        return {};
+    auto module = batch_module;
+    auto unit = batch_unit;
+    batch_module = nullptr;
+    batch_unit = nullptr;
+    // a unit that failed to emit is not pending anymore either
+    unit->pending = false;
+    auto result = emit_module(unit->batch_tracker, module, batch_flags);
+    LLVMDisposeModule(module);
+    return result;
+}
+
+static bool batch_defines(const char *name) {
+    if (!batch_module)
+        return false;
+    LLVMValueRef value = LLVMGetNamedFunction(batch_module, name);
+    if (!value) {
+        value = LLVMGetNamedGlobal(batch_module, name);
+    }
+    return value && !LLVMIsDeclaration(value);
+}
+
+static LLVMErrorRef batch_generator(
+    LLVMOrcDefinitionGeneratorRef GeneratorObj, void *Ctx,
+    LLVMOrcLookupStateRef *LookupState, LLVMOrcLookupKind Kind,
+    LLVMOrcJITDylibRef JD, LLVMOrcJITDylibLookupFlags JDLookupFlags,
+    LLVMOrcCLookupSet LookupSet, size_t LookupSetSize) {
+    for (size_t i = 0; i < LookupSetSize; ++i) {
+        auto str = LLVMOrcSymbolStringPoolEntryStr(LookupSet[i].Name);
+        if (batch_defines(str)) {
+            auto result = flush_batch();
+            if (!result.ok()) {
+                StyledString ss = StyledString::plain();
+                stream_error_message(ss.out, result.assert_error());
+                batch_error = ss.cppstr();
+                return LLVMCreateStringError(batch_error.c_str());
+            }
+            break;
+        }
+    }
+    return LLVMErrorSuccess;
+}
+
+// only reached when an emission fails that compile() didn't expect to fail;
+// the stub can't return to its caller
+static void batch_call_failed() {
+    fprintf(stderr, "failed to compile batched function: %s\n",
+        batch_error.c_str());
+    abort();
+}
+
+static bool use_batching() {
+    static int enabled = -1;
+    if (enabled < 0) {
+        const char *value = getenv("SCOPES_JIT_BATCH");
+        enabled = (value && strcmp(value, "0"));
+    }
+    return enabled;
+}
+
+// whether every symbol module references is defined by now, so that linking
+// the batch can't fail on account of it
+static bool batch_resolves(LLVMModuleRef module, const PointerMap &map) {
+    auto resolves = [&](LLVMValueRef value) {
+        if (!LLVMIsDeclaration(value))
+            return true;
+        size_t length = 0;
+        const char *name = LLVMGetValueName2(value, &length);
+        if (!length || !strncmp(name, "llvm.", 5))
+            return true;
+        std::string str(name, length);
+        return (map.find(str) != map.end())
+            || (symbol_units.find(str) != symbol_units.end())
+            || batch_defines(str.c_str())
+            || retrieve_symbol(str.c_str());
+    };
+    for (LLVMValueRef value = LLVMGetFirstFunction(module);
+        value; value = LLVMGetNextFunction(value)) {
+        if (!resolves(value))
+            return false;
+    }
+    for (LLVMValueRef value = LLVMGetFirstGlobal(module);
+        value; value = LLVMGetNextGlobal(value)) {
+        if (!resolves(value))
+            return false;
+    }
+    return true;
+}
+
+static SCOPES_RESULT(void) init_batching() {
+    SCOPES_RESULT_TYPE(void);
+    if (batch_dylib)
+        return {};
+    auto &J = unwrap_jit();
+    auto &ES = J.getExecutionSession();
+    auto manager = llvm::orc::createLocalLazyCallThroughManager(
+        J.getTargetTriple(), ES,
+        llvm::pointerToJITTargetAddress(&batch_call_failed));
+    if (!manager) {
+        SCOPES_ERROR(ExecutionEngineFailed,
+            strdup(llvm::toString(manager.takeError()).c_str()));
+    }
+    batch_call_manager = std::move(*manager);
+    batch_stubs_manager =
+        llvm::orc::createLocalIndirectStubsManagerBuilder(J.getTargetTriple())();
+
+    auto &batch = ES.createBareJITDylib("<batch>");
+    auto &main = J.getMainJITDylib();
+    batch.addToLinkOrder(main);
+    main.addToLinkOrder(batch);
+    batch_dylib = reinterpret_cast<LLVMOrcJITDylibRef>(&batch);
+    LLVMOrcJITDylibAddGenerator(batch_dylib,
+        LLVMOrcCreateCustomCAPIDefinitionGenerator(&batch_generator, nullptr));
+    return {};
+}
+
+bool can_batch_module(uint64_t compiler_flags) {
+    if (!use_batching())
+        return false;
+    return (compiler_flags & CF_Module)
+        && !(compiler_flags & (CF_DumpDisassembly | CF_DumpModule
+            | CF_DumpFunction | CF_ProfileGenerate | CF_ProfileUse));
+}
+
+SCOPES_RESULT(void) add_module_batched(LLVMModuleRef module,
+    const PointerMap &map, uint64_t compiler_flags,
+    const std::vector<std::string> &functions) {
+    SCOPES_RESULT_TYPE(void);
+    assert(can_batch_module(compiler_flags));
+    SCOPES_CHECK_RESULT(init_batching());
+    if (batch_module && (batch_flags != compiler_flags)) {
+        SCOPES_CHECK_RESULT(flush_batch());
+    }
+    if (!batch_resolves(module, map)) {
+        // emit now, so that the error reaches the caller
+        auto result = add_module(module, map, compiler_flags);
+        LLVMDisposeModule(module);
+        return result;
+    }
+    // nothing is registered before the module is part of the batch
+    JITUnit symbols;
+    collect_unit_symbols(&symbols, module);
+    if (!batch_module) {
+        batch_unit = new_unit(compiler_flags);
+        batch_unit->pending = true;
+        batch_unit->batch_tracker = unwrap_dylib(batch_dylib).createResourceTracker();
+        batch_module = module;
+        batch_flags = compiler_flags;
+    } else if (LLVMLinkModules2(batch_module, module)) {
+        SCOPES_ERROR(CGenBackendFailed, "failed to link module into batch");
+    }
+    SCOPES_CHECK_RESULT(define_pointer_map(batch_unit, map));
+    for (auto &name : symbols.defines) {
+        symbol_units[name] = batch_unit;
+        batch_unit->defines.push_back(name);
+    }
+    batch_unit->references.insert(batch_unit->references.end(),
+        symbols.references.begin(), symbols.references.end());
+    batch_unit->pinned = batch_unit->pinned || symbols.pinned;
+
+    auto &J = unwrap_jit();
+    llvm::orc::SymbolAliasMap aliases;
+    for (auto &name : functions) {
+        auto sym = J.mangleAndIntern(name);
+        aliases[sym] = llvm::orc::SymbolAliasMapEntry(sym,
+            llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+    }
+    if (auto err = J.getMainJITDylib().define(llvm::orc::lazyReexports(
+        *batch_call_manager, *batch_stubs_manager,
+        unwrap_dylib(batch_dylib), std::move(aliases)),
+        batch_unit->main_tracker)) {
+        SCOPES_ERROR(ExecutionEngineFailed,
+            strdup(llvm::toString(std::move(err)).c_str()));
+    }
+    return {};
+}
+
+SCOPES_RESULT(void) add_module(LLVMModuleRef module, const PointerMap &map,
+    uint64_t compiler_flags) {
+    SCOPES_RESULT_TYPE(void);
+    // unbatched code may refer to anything defined in the batch
+    SCOPES_CHECK_RESULT(flush_batch());
+    auto unit = new_unit(compiler_flags);
+    SCOPES_CHECK_RESULT(define_pointer_map(unit, map));
+    add_unit_symbols(unit, module);
+    return emit_module(unit->main_tracker, module, compiler_flags);
+}
+
 SCOPES_RESULT(void) add_object(const char *path) {
     SCOPES_RESULT_TYPE(void);
     LLVMErrorRef err = nullptr;
@@ -666,6 +1884,8 @@ SCOPES_RESULT(void) add_object(const char *path) {
 
 void init_llvm() {
     global_c_namespace = dlopen(NULL, RTLD_LAZY);
+    // cached objects may call into the vector math library
+    init_vector_math_library();
 
     // remove crash message
     //LLVMEnablePrettyStackTrace();
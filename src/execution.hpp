@@ -14,6 +14,7 @@
 #include <stdint.h>
 #include "absl/container/flat_hash_map.h"
 #include <string>
+#include <vector>
 
 #include "result.hpp"
 
@@ -31,13 +32,43 @@ const String *get_default_target_triple();
 SCOPES_RESULT(void) init_execution();
 SCOPES_RESULT(void) add_module(LLVMModuleRef module,
     const PointerMap &map, uint64_t compiler_flags);
+// whether add_module_batched accepts modules compiled with these flags
+bool can_batch_module(uint64_t compiler_flags);
+// takes ownership of module; functions are the symbols to provide stubs for
+SCOPES_RESULT(void) add_module_batched(LLVMModuleRef module,
+    const PointerMap &map, uint64_t compiler_flags,
+    const std::vector<std::string> &functions);
+// emits the pending batch, if there is one
+SCOPES_RESULT(void) flush_batch();
 SCOPES_RESULT(uint64_t) get_address(const char *name);
+// associates a compiled symbol with the unit that defines it; entry
+// functions keep their unit alive until released
+void track_compiled_symbol(const char *name, const void *ptr, bool entry);
+SCOPES_RESULT(void) release_compiled_function(const void *ptr);
+// unloads units that are neither live nor referenced by a live unit; the
+// symbols they defined are appended to removed
+SCOPES_RESULT(int) unload_dead_units(std::vector<std::string> &removed);
 //SCOPES_RESULT(void *) get_pointer_to_global(LLVMValueRef g);
 void *local_aware_dlsym(Symbol name);
 LLVMTargetMachineRef get_jit_target_machine();
 LLVMTargetMachineRef get_object_target_machine();
 SCOPES_RESULT(void) add_object(const char *path);
-void build_and_run_opt_passes(LLVMModuleRef module, int opt_level);
+// tm selects the cost model and vector math library; it can be null
+void build_and_run_opt_passes(LLVMModuleRef module, int opt_level,
+    LLVMTargetMachineRef tm);
+SCOPES_RESULT(void) run_profile_passes(LLVMModuleRef module,
+    uint64_t compiler_flags, bool jit);
+SCOPES_RESULT(void) write_summary_bitcode(LLVMModuleRef module, const char *path);
+SCOPES_RESULT(void) thin_lto_link(const char *triple,
+    const std::vector<std::string> &inputs, const char *path, int opt_level);
+SCOPES_RESULT(void) set_profile_input(const char *path);
+SCOPES_RESULT(void) write_profile(const char *path);
+SCOPES_RESULT(void) reset_profile();
+// entry count that profile use attached to a function, or 0
+uint64_t get_function_entry_count(LLVMValueRef func);
+// the same for compiled functions, by address
+void set_profile_entry_count(const void *ptr, uint64_t count);
+uint64_t get_profile_entry_count(const void *ptr);
 void print_disassembly(std::string symbol, void *pfunc);
 void enable_disassembly(bool enable);
 
@@ -1117,7 +1117,7 @@ struct Expander {
         SCOPES_RESULT_TYPE(sc_list_scope_tuple_t);
         ValueRef symbol_handler_node;
         const String *doc;
-        if (env->lookup(ConstInt::symbol_from(SYM_SymbolWildcard), symbol_handler_node, doc)) {
+        if (env->lookup_cached(Scope::CachedSymbolWildcard, symbol_handler_node, doc)) {
             auto T = try_get_const_type(symbol_handler_node);
             if (T != list_expander_func_type) {
                 SCOPES_TRACE_HOOK(symbol_handler_node);
@@ -1226,7 +1226,7 @@ struct Expander {
 
             ValueRef list_handler_node;
             const String *doc;
-            if (env->lookup(ConstInt::symbol_from(Symbol(SYM_ListWildcard)), list_handler_node, doc)) {
+            if (env->lookup_cached(Scope::CachedListWildcard, list_handler_node, doc)) {
                 auto T = try_get_const_type(list_handler_node);
                 if (T != list_expander_func_type) {
                     SCOPES_TRACE_HOOK(list_handler_node);
@@ -33,6 +33,8 @@
 #endif
 
 #include <deque>
+#include <unordered_set>
+#include <thread>
 
 // cleaner template specialization
 #include <type_traits>
@@ -47,6 +49,11 @@
 #include <llvm-c/DebugInfo.h>
 
 #include "llvm/IR/Module.h"
+#include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
 //#include "llvm/IR/DebugInfoMetadata.h"
 //#include "llvm/IR/DIBuilder.h"
 //#include "llvm/ExecutionEngine/SectionMemoryManager.h"
@@ -64,10 +71,6 @@ namespace scopes {
 
 #define SCOPES_GEN_TARGET "IR"
 
-// disabled because it caused odd crashes and i'm not able to maintain what
-// started as a user submitted patch
-#define SCOPES_LLVM_EXTENDED_DEBUG_INFO 0
-
 
 #if 0
 // available in LLVM 12.0.1
@@ -234,6 +237,25 @@ struct LLVMIRGenerator {
         _ns = get_pointer_namespaces(name);
     }
 
+    // functions and globals that were unloaded must be generated again
+    static void forget_symbols(const std::vector<std::string> &names) {
+        std::unordered_set<std::string> dead(names.begin(), names.end());
+        for (auto it = func_cache.begin(); it != func_cache.end();) {
+            if (dead.count(it->second)) {
+                func_cache.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = global_cache.begin(); it != global_cache.end();) {
+            if (dead.count(it->second)) {
+                global_cache.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+
     static PointerNamespaces *get_pointer_namespaces(size_t name) {
     repeat:
         auto it = pointer_namespaces.find(name);
@@ -283,7 +305,13 @@ struct LLVMIRGenerator {
     //static LLVMAttributeRef attr_byval;
     static LLVMAttributeRef attr_sret;
     static LLVMAttributeRef attr_nonnull;
+    static LLVMAttributeRef attr_readnone;
+    static LLVMAttributeRef attr_nounwind;
+    static LLVMAttributeRef attr_cold;
     static unsigned attr_kind_sret;
+    static unsigned md_kind_prof;
+    static LLVMValueRef md_unlikely_else;
+    static LLVMValueRef md_unlikely_then;
     static unsigned attr_kind_byval;
     LLVMValueRef intrinsics[NumIntrinsics];
 
@@ -299,7 +327,6 @@ struct LLVMIRGenerator {
 
     absl::flat_hash_map< PMIntrinsicKey, LLVMValueRef, HashPMIntrinsicKey > pm_intrinsics;
 
-#if SCOPES_LLVM_EXTENDED_DEBUG_INFO
     LLVMMetadataRef debug_voidT;
     LLVMMetadataRef debug_i1T;
     LLVMMetadataRef debug_i8T;
@@ -318,11 +345,23 @@ struct LLVMIRGenerator {
     std::vector<const Type *> debug_type_todo;
     std::vector<std::pair<LLVMMetadataRef, LLVMMetadataRef>> debug_type_to_replace;
     LLVMMetadataRef current_debug_block = nullptr;
-#endif
+    // file scopes of the function being translated
+    absl::flat_hash_map<Symbol, LLVMMetadataRef, Symbol::Hash> debug_file_scopes;
 
+    // by default, only line tables are emitted, which is enough for
+    // tracebacks and profilers
     bool use_debug_info = true;
+    // types and variables are described for exported functions only. this
+    // started as a user submitted patch that used to cause odd crashes, so
+    // only compile_object offers it, and only on request.
+    bool use_full_debug_info = false;
+    // whether the function being translated gets full debug info
+    bool function_full_debug_info = false;
     bool generate_object = false;
     bool serialize_pointers = false;
+    // profiled modules must not link against functions generated before,
+    // since those lack the instrumentation or the profile
+    bool private_functions = false;
     FunctionRef active_function;
     FunctionRef entry_function;
     std::vector<LLVMValueRef> generated_symbols;
@@ -550,6 +589,14 @@ struct LLVMIRGenerator {
         result = LLVMAddFunction(module, STRNAME, LLVMFunctionType(RETTYPE, argtypes, sizeof(argtypes) / sizeof(LLVMTypeRef), false)); \
     } break;
 
+#define LLVM_LIBM_IMPL(ENUMVAL, RETTYPE, STRNAME, ...) \
+    case ENUMVAL: { \
+        LLVMTypeRef argtypes[] = {__VA_ARGS__}; \
+        result = LLVMAddFunction(module, STRNAME, LLVMFunctionType(RETTYPE, argtypes, sizeof(argtypes) / sizeof(LLVMTypeRef), false)); \
+        LLVMAddAttributeAtIndex(result, LLVMAttributeFunctionIndex, attr_readnone); \
+        LLVMAddAttributeAtIndex(result, LLVMAttributeFunctionIndex, attr_nounwind); \
+    } break;
+
 #define LLVM_INTRINSIC_IMPL_BEGIN(ENUMVAL, RETTYPE, STRNAME, ...) \
     case ENUMVAL: { \
         LLVMTypeRef argtypes[] = { __VA_ARGS__ }; \
@@ -588,28 +635,30 @@ struct LLVMIRGenerator {
             LLVM_INTRINSIC_IMPL(llvm_log2_f32, f32T, "llvm.log2.f32", f32T)
             LLVM_INTRINSIC_IMPL(llvm_log2_f64, f64T, "llvm.log2.f64", f64T)
 
-            LLVM_INTRINSIC_IMPL(libc_tan_f32, f32T, "tanf", f32T)
-            LLVM_INTRINSIC_IMPL(libc_tan_f64, f64T, "tan", f64T)
-            LLVM_INTRINSIC_IMPL(libc_asin_f32, f32T, "asinf", f32T)
-            LLVM_INTRINSIC_IMPL(libc_asin_f64, f64T, "asin", f64T)
-            LLVM_INTRINSIC_IMPL(libc_acos_f32, f32T, "acosf", f32T)
-            LLVM_INTRINSIC_IMPL(libc_acos_f64, f64T, "acos", f64T)
-            LLVM_INTRINSIC_IMPL(libc_atan_f32, f32T, "atanf", f32T)
-            LLVM_INTRINSIC_IMPL(libc_atan_f64, f64T, "atan", f64T)
-            LLVM_INTRINSIC_IMPL(libc_atan2_f32, f32T, "atan2f", f32T, f32T)
-            LLVM_INTRINSIC_IMPL(libc_atan2_f64, f64T, "atan2", f64T, f64T)
-            LLVM_INTRINSIC_IMPL(libc_sinh_f32, f32T, "sinhf", f32T)
-            LLVM_INTRINSIC_IMPL(libc_sinh_f64, f64T, "sinh", f64T)
-            LLVM_INTRINSIC_IMPL(libc_cosh_f32, f32T, "coshf", f32T)
-            LLVM_INTRINSIC_IMPL(libc_cosh_f64, f64T, "cosh", f64T)
-            LLVM_INTRINSIC_IMPL(libc_tanh_f32, f32T, "tanhf", f32T)
-            LLVM_INTRINSIC_IMPL(libc_tanh_f64, f64T, "tanh", f64T)
-            LLVM_INTRINSIC_IMPL(libc_asinh_f32, f32T, "asinhf", f32T)
-            LLVM_INTRINSIC_IMPL(libc_asinh_f64, f64T, "asinh", f64T)
-            LLVM_INTRINSIC_IMPL(libc_acosh_f32, f32T, "acoshf", f32T)
-            LLVM_INTRINSIC_IMPL(libc_acosh_f64, f64T, "acosh", f64T)
-            LLVM_INTRINSIC_IMPL(libc_atanh_f32, f32T, "atanhf", f32T)
-            LLVM_INTRINSIC_IMPL(libc_atanh_f64, f64T, "atanh", f64T)
+            // scopes doesn't observe errno, so these are free of side effects,
+            // which allows the vectorizers to replace them
+            LLVM_LIBM_IMPL(libc_tan_f32, f32T, "tanf", f32T)
+            LLVM_LIBM_IMPL(libc_tan_f64, f64T, "tan", f64T)
+            LLVM_LIBM_IMPL(libc_asin_f32, f32T, "asinf", f32T)
+            LLVM_LIBM_IMPL(libc_asin_f64, f64T, "asin", f64T)
+            LLVM_LIBM_IMPL(libc_acos_f32, f32T, "acosf", f32T)
+            LLVM_LIBM_IMPL(libc_acos_f64, f64T, "acos", f64T)
+            LLVM_LIBM_IMPL(libc_atan_f32, f32T, "atanf", f32T)
+            LLVM_LIBM_IMPL(libc_atan_f64, f64T, "atan", f64T)
+            LLVM_LIBM_IMPL(libc_atan2_f32, f32T, "atan2f", f32T, f32T)
+            LLVM_LIBM_IMPL(libc_atan2_f64, f64T, "atan2", f64T, f64T)
+            LLVM_LIBM_IMPL(libc_sinh_f32, f32T, "sinhf", f32T)
+            LLVM_LIBM_IMPL(libc_sinh_f64, f64T, "sinh", f64T)
+            LLVM_LIBM_IMPL(libc_cosh_f32, f32T, "coshf", f32T)
+            LLVM_LIBM_IMPL(libc_cosh_f64, f64T, "cosh", f64T)
+            LLVM_LIBM_IMPL(libc_tanh_f32, f32T, "tanhf", f32T)
+            LLVM_LIBM_IMPL(libc_tanh_f64, f64T, "tanh", f64T)
+            LLVM_LIBM_IMPL(libc_asinh_f32, f32T, "asinhf", f32T)
+            LLVM_LIBM_IMPL(libc_asinh_f64, f64T, "asinh", f64T)
+            LLVM_LIBM_IMPL(libc_acosh_f32, f32T, "acoshf", f32T)
+            LLVM_LIBM_IMPL(libc_acosh_f64, f64T, "acosh", f64T)
+            LLVM_LIBM_IMPL(libc_atanh_f32, f32T, "atanhf", f32T)
+            LLVM_LIBM_IMPL(libc_atanh_f64, f64T, "atanh", f64T)
 
             LLVM_INTRINSIC_IMPL_BEGIN(custom_fsign_f32, f32T, "custom.fsign.f32", f32T)
                 // (0 < val) - (val < 0)
@@ -648,6 +697,7 @@ struct LLVMIRGenerator {
                     LLVMGetParam(result, 0), LLVMConstReal(f64T, rad2deg), ""));
             LLVM_INTRINSIC_IMPL_END()
 #undef LLVM_INTRINSIC_IMPL
+#undef LLVM_LIBM_IMPL
 #undef LLVM_INTRINSIC_IMPL_BEGIN
 #undef LLVM_INTRINSIC_IMPL_END
             default: assert(false); break;
@@ -691,8 +741,24 @@ struct LLVMIRGenerator {
         //attr_byval = get_attribute(get_attribute_kind("byval"));
         attr_sret = get_attribute(get_attribute_kind("sret"));
         attr_nonnull = get_attribute(get_attribute_kind("nonnull"));
+        attr_readnone = get_attribute(get_attribute_kind("readnone"));
+        attr_nounwind = get_attribute(get_attribute_kind("nounwind"));
+        attr_cold = get_attribute(get_attribute_kind("cold"));
         attr_kind_sret = get_attribute_kind("sret");
         attr_kind_byval = get_attribute_kind("byval");
+        {
+            // same weights clang uses for __builtin_expect
+            const char *weights = "branch_weights";
+            md_kind_prof = LLVMGetMDKindID("prof", 4);
+            LLVMValueRef md[3];
+            md[0] = LLVMMDString(weights, strlen(weights));
+            md[1] = LLVMConstInt(i32T, 2000, false);
+            md[2] = LLVMConstInt(i32T, 1, false);
+            md_unlikely_else = LLVMMDNode(md, 3);
+            md[1] = LLVMConstInt(i32T, 1, false);
+            md[2] = LLVMConstInt(i32T, 2000, false);
+            md_unlikely_then = LLVMMDNode(md, 3);
+        }
 
         LLVMContextSetDiagnosticHandler(LLVMGetGlobalContext(),
             diag_handler,
@@ -1098,7 +1164,6 @@ struct LLVMIRGenerator {
         return typeref;
     }
 
-#if SCOPES_LLVM_EXTENDED_DEBUG_INFO
     SCOPES_RESULT(LLVMMetadataRef) create_llvm_debug_type(const Type *type) {
         SCOPES_RESULT_TYPE(LLVMMetadataRef);
         using namespace llvm::dwarf;
@@ -1279,7 +1344,6 @@ struct LLVMIRGenerator {
         }
         debug_type_to_replace.clear();
     }
-#endif
 
     static Error *last_llvm_error;
     static void fatal_error_handler(const char *Reason) {
@@ -1397,6 +1461,9 @@ struct LLVMIRGenerator {
         auto bb = LLVMAppendBasicBlock(func, "");
 
         try_info.clear();
+        debug_file_scopes.clear();
+        function_full_debug_info = use_full_debug_info
+            && (func_export_table.find(node.unref()) != func_export_table.end());
 
         if (!node->raises.empty()) {
             try_info.bb_except = LLVMAppendBasicBlock(func, "except");
@@ -1430,8 +1497,7 @@ struct LLVMIRGenerator {
         for (size_t i = 0; i < paramcount; ++i) {
             ParameterRef param = params[i];
             LLVMValueRef val = SCOPES_GET_RESULT(abi_import_argument(param->get_type(), func, k));
-#if SCOPES_LLVM_EXTENDED_DEBUG_INFO
-            if (use_debug_info) {
+            if (function_full_debug_info) {
                 auto subprogram = LLVMGetSubprogram(func);
                 current_debug_block = subprogram;
                 auto ty = LLVMTypeOf(val);
@@ -1446,17 +1512,14 @@ struct LLVMIRGenerator {
                 auto expr = LLVMDIBuilderCreateExpression(di_builder, 0, 0);
                 LLVMDIBuilderInsertDeclareAtEnd(di_builder, alloc, divar, expr, anchor_to_location(anchor), LLVMGetInsertBlock(builder));
             }
-#endif
 
             assert(val);
             bind(ValueIndex(param), val);
         }
         SCOPES_CHECK_RESULT(translate_block(node->body));
-#if SCOPES_LLVM_EXTENDED_DEBUG_INFO
-        if (use_debug_info) {
+        if (function_full_debug_info) {
             current_debug_block = nullptr;
         }
-#endif
         return {};
     }
 
@@ -1477,7 +1540,7 @@ struct LLVMIRGenerator {
                 is_export = true;
             }
         } else {
-            auto it = func_cache.find(node.unref());
+            auto it = private_functions?func_cache.end():func_cache.find(node.unref());
             if (it == func_cache.end()) {
                 auto funcname = node->name;
                 StyledString ss = StyledString::plain();
@@ -1499,7 +1562,8 @@ struct LLVMIRGenerator {
                 ss.out << get_func_pointer_id(node.unref());
                 name = ss.cppstr();
 
-                func_cache.insert({node.unref(), name});
+                if (!private_functions)
+                    func_cache.insert({node.unref(), name});
             } else {
                 name = it->second;
                 is_external = true;
@@ -1509,6 +1573,10 @@ struct LLVMIRGenerator {
         auto functype = SCOPES_GET_RESULT(type_to_llvm_type(ilfunctype));
 
         auto func = LLVMAddFunction(module, name.c_str(), functype);
+        if (ilfunctype->has_exception() && !is_returning(ilfunctype->return_type)) {
+            // a function that can only raise is an error path
+            LLVMAddAttributeAtIndex(func, LLVMAttributeFunctionIndex, attr_cold);
+        }
 
         if (is_external)
             return func;
@@ -1548,9 +1616,8 @@ struct LLVMIRGenerator {
 
     SCOPES_RESULT(void) translate_block(const Block &node) {
         SCOPES_RESULT_TYPE(void);
-#if SCOPES_LLVM_EXTENDED_DEBUG_INFO
         LLVMMetadataRef parent_block = nullptr;
-        if (use_debug_info) {
+        if (function_full_debug_info) {
             parent_block = current_debug_block;
             if (!node.body.empty()) {
                 auto anchor = node.body[0].anchor();
@@ -1558,18 +1625,15 @@ struct LLVMIRGenerator {
                 current_debug_block = LLVMDIBuilderCreateLexicalBlock(di_builder, current_debug_block, difile, anchor->lineno, anchor->column);
             }
         }
-#endif
         for (auto entry : node.body) {
             SCOPES_CHECK_RESULT(translate_instruction(entry));
         }
         if (node.terminator) {
             SCOPES_CHECK_RESULT(translate_instruction(node.terminator));
         }
-#if SCOPES_LLVM_EXTENDED_DEBUG_INFO
-        if (use_debug_info) {
+        if (function_full_debug_info) {
             current_debug_block = parent_block;
         }
-#endif
         return {};
     }
 
@@ -1930,8 +1994,7 @@ struct LLVMIRGenerator {
         } else {
             val = safe_alloca(ty);
         }
-#if SCOPES_LLVM_EXTENDED_DEBUG_INFO
-        if (use_debug_info) {
+        if (function_full_debug_info) {
             LLVMBasicBlockRef bb = LLVMGetInsertBlock(builder);
             LLVMValueRef func = LLVMGetBasicBlockParent(bb);
             auto subprogram = LLVMGetSubprogram(func);
@@ -1944,7 +2007,6 @@ struct LLVMIRGenerator {
             auto expr = LLVMDIBuilderCreateExpression(di_builder, 0, 0);
             LLVMDIBuilderInsertDeclareAtEnd(di_builder, val, divar, expr, anchor_to_location(anchor), LLVMGetInsertBlock(builder));
         }
-#endif
         map_phi({ val }, node);
         return {};
     }
@@ -2477,6 +2539,12 @@ struct LLVMIRGenerator {
         LLVMPositionBuilderAtEnd(builder, bb);
     }
 
+    // blocks that leave by raising or never leave at all are error paths
+    static bool is_cold_block(const Block &block) {
+        auto &&term = block.terminator;
+        return term && (term.isa<Raise>() || term.isa<Unreachable>());
+    }
+
     SCOPES_RESULT(void) translate_CondBr(const CondBrRef &node) {
         SCOPES_RESULT_TYPE(void);
         LLVMBasicBlockRef bb = LLVMGetInsertBlock(builder);
@@ -2485,7 +2553,13 @@ struct LLVMIRGenerator {
         assert(cond);
         LLVMBasicBlockRef bbthen = LLVMAppendBasicBlock(func, "then");
         LLVMBasicBlockRef bbelse = LLVMAppendBasicBlock(func, "else");
-        LLVMBuildCondBr(builder, cond, bbthen, bbelse);
+        auto br = LLVMBuildCondBr(builder, cond, bbthen, bbelse);
+        if (is_cold_block(node->else_body)) {
+            if (!is_cold_block(node->then_body))
+                LLVMSetMetadata(br, md_kind_prof, md_unlikely_else);
+        } else if (is_cold_block(node->then_body)) {
+            LLVMSetMetadata(br, md_kind_prof, md_unlikely_then);
+        }
 
         // write then-block
         {
@@ -2921,7 +2995,8 @@ struct LLVMIRGenerator {
                 if (has_except_value || has_return_value) {
                     ok = LLVMBuildExtractValue(builder, ret, 0, "");
                 }
-                LLVMBuildCondBr(builder, ok, bb, bb_except);
+                auto br = LLVMBuildCondBr(builder, ok, bb, bb_except);
+                LLVMSetMetadata(br, md_kind_prof, md_unlikely_else);
                 position_builder_at_end(bb);
                 if (has_return_value) {
                     int retvalue_index = (has_except_value?2:1);
@@ -2951,8 +3026,15 @@ struct LLVMIRGenerator {
 
         LLVMMetadataRef scope = disp;
         if (active_function.anchor()->path != anchor->path) {
-            LLVMMetadataRef difile = source_file_to_scope(anchor->path);
-            scope = LLVMDIBuilderCreateLexicalBlock(di_builder, disp, difile, 1, 1);
+            // code inlined from another file; one scope per file will do
+            auto it = debug_file_scopes.find(anchor->path);
+            if (it != debug_file_scopes.end()) {
+                scope = it->second;
+            } else {
+                LLVMMetadataRef difile = source_file_to_scope(anchor->path);
+                scope = LLVMDIBuilderCreateLexicalBlockFile(di_builder, disp, difile, 0);
+                debug_file_scopes.insert({ anchor->path, scope });
+            }
         }
 
         LLVMMetadataRef result = LLVMDIBuilderCreateDebugLocation(
@@ -3038,7 +3120,6 @@ struct LLVMIRGenerator {
         }
     }
 
-#if SCOPES_LLVM_EXTENDED_DEBUG_INFO
     void init_debug_types() {
         using namespace llvm::dwarf;
         debug_voidT = LLVMDIBuilderCreateBasicType(di_builder, "void", 4, 0, DW_ATE_unsigned, LLVMDIFlagZero);
@@ -3056,7 +3137,6 @@ struct LLVMIRGenerator {
         debug_noneT = LLVMDIBuilderCreateBasicType(di_builder, "none", 4, 0, DW_ATE_unsigned, LLVMDIFlagZero); // TODO: Not sure
         debug_rawstringT = LLVMDIBuilderCreatePointerType(di_builder, debug_i8T, PointerType::size() * 8, 0, 0, "", 0);
     }
-#endif
 
     void setup_generate(const char *module_name) {
         module = LLVMModuleCreateWithName(module_name);
@@ -3087,7 +3167,8 @@ struct LLVMIRGenerator {
                 /*Flags*/ "", 0,
                 /*RuntimeVer*/ 0,
                 /*SplitName*/ "", 0,
-                /*Kind*/ LLVMDWARFEmissionFull,
+                /*Kind*/ (use_full_debug_info?
+                    LLVMDWARFEmissionFull:LLVMDWARFEmissionLineTablesOnly),
                 /*DWOId*/ 0,
                 /*SplitDebugInlining*/ true,
                 /*DebugInfoForProfiling*/ false,
@@ -3098,9 +3179,8 @@ struct LLVMIRGenerator {
 
             //LLVMAddNamedMetadataOperand(module, "llvm.dbg.cu", dicu);
 
-#if SCOPES_LLVM_EXTENDED_DEBUG_INFO
-            init_debug_types();
-#endif
+            if (use_full_debug_info)
+                init_debug_types();
         }
     }
 
@@ -3118,12 +3198,13 @@ struct LLVMIRGenerator {
         SCOPES_RESULT_TYPE(void);
         size_t k = SCOPES_GET_RESULT(finalize_types());
         assert(!k);
-#if SCOPES_LLVM_EXTENDED_DEBUG_INFO
-        size_t kd = SCOPES_GET_RESULT(finalize_debug_types());
-        assert(!kd);
+        if (use_full_debug_info) {
+            size_t kd = SCOPES_GET_RESULT(finalize_debug_types());
+            assert(!kd);
+            (void)kd;
 
-        replace_debug_types();
-#endif
+            replace_debug_types();
+        }
 
         LLVMDisposeBuilder(builder);
         LLVMDIBuilderFinalize(di_builder);
@@ -3285,22 +3366,119 @@ LLVMValueRef LLVMIRGenerator::trueV = nullptr;
 //LLVMAttributeRef LLVMIRGenerator::attr_byval = nullptr;
 LLVMAttributeRef LLVMIRGenerator::attr_sret = nullptr;
 LLVMAttributeRef LLVMIRGenerator::attr_nonnull = nullptr;
+LLVMAttributeRef LLVMIRGenerator::attr_readnone = nullptr;
+LLVMAttributeRef LLVMIRGenerator::attr_nounwind = nullptr;
+LLVMAttributeRef LLVMIRGenerator::attr_cold = nullptr;
 unsigned LLVMIRGenerator::attr_kind_sret = 0;
+unsigned LLVMIRGenerator::md_kind_prof = 0;
+LLVMValueRef LLVMIRGenerator::md_unlikely_else = nullptr;
+LLVMValueRef LLVMIRGenerator::md_unlikely_then = nullptr;
 unsigned LLVMIRGenerator::attr_kind_byval = 0;
 
 //------------------------------------------------------------------------------
 // IL COMPILER
 //------------------------------------------------------------------------------
 
+/*
+    with the parallel flag, compile-object partitions the optimized module and
+    generates code for the partitions on as many threads. the number of
+    partitions is taken from SCOPES_CODEGEN_THREADS, or else the number of
+    processors. the path names a directory, which is created if it doesn't
+    exist, and partition i is written to <path>/<i>.o (or <i>.s for assembly).
+    internal symbols are promoted to hidden ones with unique names, so that the
+    partitions can reference each other and can be linked or merged (ld -r)
+    like a single object.
+*/
+static unsigned codegen_partition_count(LLVMModuleRef module) {
+    unsigned count = std::thread::hardware_concurrency();
+    const char *env = getenv("SCOPES_CODEGEN_THREADS");
+    if (env) {
+        count = (unsigned)atoi(env);
+    }
+    // no point in more partitions than functions
+    unsigned functions = 0;
+    for (LLVMValueRef value = LLVMGetFirstFunction(module);
+         value && (functions < count); value = LLVMGetNextFunction(value)) {
+        if (!LLVMIsDeclaration(value))
+            functions++;
+    }
+    return std::max(functions, 1u);
+}
+
+static SCOPES_RESULT(void) split_codegen(LLVMModuleRef module,
+    LLVMTargetRef target, const char *triple, CompilerFileKind kind,
+    const String *path) {
+    SCOPES_RESULT_TYPE(void);
+    std::string dir(path->data, path->count);
+    if (llvm::sys::fs::exists(dir) && !llvm::sys::fs::is_directory(dir)) {
+        SCOPES_ERROR(CGenBackendFailed,
+            strdup((dir + ": parallel code generation writes one file per "
+                "partition and requires a directory path").c_str()));
+    }
+    {
+        auto ec = llvm::sys::fs::create_directories(dir);
+        if (ec) {
+            SCOPES_ERROR(CGenBackendFailed,
+                strdup((dir + ": " + ec.message()).c_str()));
+        }
+    }
+    const char *ext = (kind == CFK_ASM)?".s":".o";
+    unsigned count = codegen_partition_count(module);
+    std::vector<std::unique_ptr<llvm::raw_fd_ostream>> files;
+    std::vector<llvm::raw_pwrite_stream *> streams;
+    for (unsigned i = 0; i < count; ++i) {
+        auto filename = dir + "/" + std::to_string(i) + ext;
+        std::error_code ec;
+        files.emplace_back(new llvm::raw_fd_ostream(filename, ec,
+            llvm::sys::fs::OF_None));
+        if (ec) {
+            SCOPES_ERROR(CGenBackendFailed,
+                strdup((filename + ": " + ec.message()).c_str()));
+        }
+        streams.push_back(files.back().get());
+    }
+    auto factory = [=]() {
+        // every thread needs its own target machine
+        auto tm = LLVMCreateTargetMachine(target, triple, nullptr, nullptr,
+            LLVMCodeGenLevelDefault, LLVMRelocPIC, LLVMCodeModelJITDefault);
+        return std::unique_ptr<llvm::TargetMachine>(
+            reinterpret_cast<llvm::TargetMachine *>(tm));
+    };
+    auto filetype = (kind == CFK_ASM)?llvm::CGFT_AssemblyFile:llvm::CGFT_ObjectFile;
+#if LLVM_VERSION_MAJOR >= 13
+    llvm::splitCodeGen(*llvm::unwrap(module), streams, {}, factory, filetype);
+#else
+    // the module may be consumed, but it isn't used afterwards
+    llvm::splitCodeGen(std::unique_ptr<llvm::Module>(llvm::unwrap(module)),
+        streams, {}, factory, filetype).release();
+#endif
+    for (auto &file : files) {
+        file->close();
+        if (file->has_error()) {
+            auto msg = file->error().message();
+            file->clear_error();
+            SCOPES_ERROR(CGenBackendFailed, strdup(msg.c_str()));
+        }
+    }
+    return {};
+}
+
 template <typename T> 
 SCOPES_RESULT(T) compile_object(const String *triple, CompilerFileKind kind, const String *path, const Scope *scope, uint64_t flags) {
     SCOPES_RESULT_TYPE(T);
     Timer sum_compile_time(TIMER_Compile);
 
+    if ((flags & CF_ThinLTO) && (kind != CFK_BC)) {
+        SCOPES_ERROR(CGenBackendFailed,
+            "thin-lto requires compiler-file-kind-bc");
+    }
+
     LLVMIRGenerator ctx;
     ctx.generate_object = true;
     if (flags & CF_NoDebugInfo) {
         ctx.use_debug_info = false;
+    } else if (flags & CF_FullDebugInfo) {
+        ctx.use_full_debug_info = true;
     }
 
     LLVMModuleRef module;
@@ -3309,21 +3487,7 @@ SCOPES_RESULT(T) compile_object(const String *triple, CompilerFileKind kind, con
         module = SCOPES_GET_RESULT(ctx.generate(path, scope));
     }
 
-    if (flags & CF_O3) {
-        Timer optimize_timer(TIMER_Optimize);
-        int level = 0;
-        if ((flags & CF_O3) == CF_O1)
-            level = 1;
-        else if ((flags & CF_O3) == CF_O2)
-            level = 2;
-        else if ((flags & CF_O3) == CF_O3)
-            level = 3;
-        build_and_run_opt_passes(module, level);
-    }
-
-    if (flags & CF_DumpModule) {
-        LLVMDumpModule(module);
-    }
+    SCOPES_CHECK_RESULT(run_profile_passes(module, flags, false));
 
     auto tt = LLVMNormalizeTargetTriple(triple->data);
     static char triplestr[1024];
@@ -3341,10 +3505,30 @@ SCOPES_RESULT(T) compile_object(const String *triple, CompilerFileKind kind, con
         LLVMCodeGenLevelDefault, LLVMRelocPIC, LLVMCodeModelJITDefault);
     assert(tm);
 
+    if (flags & CF_O3) {
+        Timer optimize_timer(TIMER_Optimize);
+        int level = 0;
+        if ((flags & CF_O3) == CF_O1)
+            level = 1;
+        else if ((flags & CF_O3) == CF_O2)
+            level = 2;
+        else if ((flags & CF_O3) == CF_O3)
+            level = 3;
+        build_and_run_opt_passes(module, level, tm);
+    }
+
+    if (flags & CF_DumpModule) {
+        LLVMDumpModule(module);
+    }
+
     char *path_cstr = strdup(path->data);
     LLVMBool failed = false;
 
     if constexpr (std::is_void_v<T>) {
+        if ((flags & CF_Parallel) && ((kind == CFK_Object) || (kind == CFK_ASM))) {
+            free(path_cstr);
+            return split_codegen(module, target, triplestr, kind, path);
+        }
         switch(kind) {
             case CFK_Object: {
                 failed = LLVMTargetMachineEmitToFile(tm, module, path_cstr,
@@ -3355,6 +3539,11 @@ SCOPES_RESULT(T) compile_object(const String *triple, CompilerFileKind kind, con
                     LLVMAssemblyFile, &error_message);
             } break;
             case CFK_BC: {
+                if (flags & CF_ThinLTO) {
+                    auto result = write_summary_bitcode(module, path_cstr);
+                    free(path_cstr);
+                    return result;
+                }
                 failed = LLVMWriteBitcodeToFile(module, path_cstr);
             } break;
             case CFK_LLVM: {
@@ -3436,6 +3625,7 @@ SCOPES_RESULT(ConstPointerRef) compile(const FunctionRef &fn, uint64_t flags) {
     if (flags & CF_NoDebugInfo) {
         ctx.use_debug_info = false;
     }
+    ctx.private_functions = (flags & (CF_ProfileGenerate | CF_ProfileUse));
 
     LLVMIRGenerator::ModuleValuePair result;
     {
@@ -3461,6 +3651,24 @@ SCOPES_RESULT(ConstPointerRef) compile(const FunctionRef &fn, uint64_t flags) {
 
     SCOPES_CHECK_RESULT(init_execution());
 
+    uint64_t entry_count = 0;
+    if (ctx.private_functions) {
+        SCOPES_CHECK_RESULT(run_profile_passes(module, flags, true));
+        if (flags & CF_ProfileUse) {
+            entry_count = get_function_entry_count(func);
+        }
+        // the profile refers to the generated names; the JIT may already
+        // hold other versions under the same names
+        static int profiled_modules = 0;
+        auto suffix = ".profiled" + std::to_string(profiled_modules++);
+        for (auto sym : ctx.generated_symbols) {
+            size_t length = 0;
+            const char *name = LLVMGetValueName2(sym, &length);
+            auto newname = std::string(name, length) + suffix;
+            LLVMSetValueName2(sym, newname.c_str(), newname.size());
+        }
+    }
+
     std::string funcname;
     {
         size_t length = 0;
@@ -3481,7 +3689,12 @@ SCOPES_RESULT(ConstPointerRef) compile(const FunctionRef &fn, uint64_t flags) {
         enable_disassembly(true);
     }
 
-    SCOPES_CHECK_RESULT(add_module(module, ctx.pointer_map, flags));
+    if (can_batch_module(flags)) {
+        // module is consumed; the dump flags exclude batching
+        SCOPES_CHECK_RESULT(add_module_batched(module, ctx.pointer_map, flags, bindsyms));
+    } else {
+        SCOPES_CHECK_RESULT(add_module(module, ctx.pointer_map, flags));
+    }
 
     if (flags & CF_DumpModule) {
         LLVMDumpModule(module);
@@ -3493,6 +3706,7 @@ SCOPES_RESULT(ConstPointerRef) compile(const FunctionRef &fn, uint64_t flags) {
     for (auto sym : bindsyms) {
         void *ptr = (void *)SCOPES_GET_RESULT(get_address(sym.c_str()));
         set_address_name(ptr, String::from(sym.c_str(), sym.size()));
+        track_compiled_symbol(sym.c_str(), ptr, sym == funcname);
     }
 #endif
 
@@ -3501,8 +3715,29 @@ SCOPES_RESULT(ConstPointerRef) compile(const FunctionRef &fn, uint64_t flags) {
     if (flags & CF_DumpDisassembly) {
         print_disassembly(funcname, pfunc);
     }
+    if (flags & CF_ProfileUse) {
+        set_profile_entry_count(pfunc, entry_count);
+    }
 
     return ref(fn.anchor(), ConstPointer::from(functype, pfunc).cast<ConstPointer>());
 }
 
+SCOPES_RESULT(void) release_compiled(const ConstPointerRef &ptr) {
+    return release_compiled_function(ptr->value);
+}
+
+SCOPES_RESULT(void) flush_compiled() {
+    return flush_batch();
+}
+
+SCOPES_RESULT(int) collect_compiled() {
+    SCOPES_RESULT_TYPE(int);
+    std::vector<std::string> removed;
+    int count = SCOPES_GET_RESULT(unload_dead_units(removed));
+    if (!removed.empty()) {
+        LLVMIRGenerator::forget_symbols(removed);
+    }
+    return count;
+}
+
 } // namespace scopes
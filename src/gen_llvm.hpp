@@ -36,6 +36,14 @@ SCOPES_RESULT(T) compile_object(const String *triple, CompilerFileKind kind,
     const String *path, const Scope *scope, uint64_t flags);
 
 SCOPES_RESULT(ConstPointerRef) compile(const FunctionRef &fn, uint64_t flags);
+// marks a function returned by compile as no longer in use
+SCOPES_RESULT(void) release_compiled(const ConstPointerRef &ptr);
+// unloads compiled code that is no longer in use; returns the number of
+// modules that were unloaded
+SCOPES_RESULT(int) collect_compiled();
+// emits batched functions that haven't been emitted yet, so that errors are
+// reported before they are called
+SCOPES_RESULT(void) flush_compiled();
 
 } // namespace scopes
 
@@ -18,6 +18,7 @@
 #include "compiler_flags.hpp"
 #include "prover.hpp"
 #include "hash.hpp"
+#include "cache.hpp"
 #include "qualifiers.hpp"
 #include "qualifier.inc"
 #include "verify_tools.inc"
@@ -37,6 +38,11 @@
 #include "dyn_cast.inc"
 #include "absl/container/flat_hash_map.h"
 
+#include <map>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
 #pragma GCC diagnostic ignored "-Wvla-extension"
 
 namespace scopes {
@@ -183,11 +189,14 @@ static void format_spv_location(StyledStream &ss, const char* source,
     ss << ":" << Style_None << " ";
 }
 
-static SCOPES_RESULT(void) verify_spirv(spv_target_env env, std::vector<unsigned int> &contents) {
-    SCOPES_RESULT_TYPE(void);
+// the validation, optimization and cross-compilation steps may run on worker
+// threads; they must not allocate scopes values, so diagnostics are collected
+// as text and reported by the calling thread.
+
+static bool validate_spirv(spv_target_env env,
+    const std::vector<unsigned int> &contents, StyledString &ss) {
     //spvtools::ValidatorOptions options;
 
-    StyledString ss;
     spvtools::SpirvTools tools(env);
     tools.SetMessageConsumer([&ss](spv_message_level_t level, const char* source,
                                 const spv_position_t& position,
@@ -215,8 +224,13 @@ static SCOPES_RESULT(void) verify_spirv(spv_target_env env, std::vector<unsigned
         }
     });
 
-    bool succeed = tools.Validate(contents);
-    if (!succeed) {
+    return tools.Validate(contents);
+}
+
+static SCOPES_RESULT(void) verify_spirv(spv_target_env env, std::vector<unsigned int> &contents) {
+    SCOPES_RESULT_TYPE(void);
+    StyledString ss;
+    if (!validate_spirv(env, contents, ss)) {
         disassemble_spirv(contents, true);
         SCOPES_CERR << ss._ss.str();
         SCOPES_ERROR(CGenBackendValidationFailed);
@@ -241,7 +255,8 @@ struct SPIRVGenerator {
     std::deque<FunctionRef> function_todo;
     absl::flat_hash_map<TypeFlagPair, spv::Id, HashTypeFlagsPair> type_cache;
 
-    absl::flat_hash_map<int, ExecutionMode *> execution_modes;
+    // ordered, so that identical functions produce identical binaries
+    std::map<int, ExecutionMode *> execution_modes;
 
     absl::flat_hash_map<Symbol, spv::Id, Symbol::Hash> intrinsics;
     absl::flat_hash_map<Symbol, spv::Id, Symbol::Hash> intrinsic_ops;
@@ -2372,8 +2387,6 @@ struct SPIRVGenerator {
         }
         builder.dump(version, result);
 
-        SCOPES_CHECK_RESULT(verify_spirv(env, result));
-
         return {};
     }
 
@@ -2381,8 +2394,8 @@ struct SPIRVGenerator {
 
 //------------------------------------------------------------------------------
 
-SCOPES_RESULT(void) optimize_spirv(spv_target_env env, std::vector<unsigned int> &result, int opt_level) {
-    SCOPES_RESULT_TYPE(void);
+static bool run_optimize_spirv(spv_target_env env,
+    std::vector<unsigned int> &result, int opt_level, StyledString &log) {
     spvtools::Optimizer optimizer(env);
     /*
     optimizer.SetMessageConsumer([](spv_message_level_t level, const char* source,
@@ -2391,7 +2404,7 @@ SCOPES_RESULT(void) optimize_spirv(spv_target_env env, std::vector<unsigned int>
     SCOPES_CERR << StringifyMessage(level, source, position, message)
     << std::endl;
     });*/
-    StyledStream ss(SCOPES_CERR);
+    StyledStream &ss = log.out;
     optimizer.SetMessageConsumer([&ss](spv_message_level_t level, const char*,
         const spv_position_t& position,
         const char* message) {
@@ -2442,153 +2455,318 @@ SCOPES_RESULT(void) optimize_spirv(spv_target_env env, std::vector<unsigned int>
     optimizer.RegisterPass(spvtools::CreateFlattenDecorationPass());
     //optimizer.RegisterPass(spvtools::CreateCompactIdsPass());
 
-    std::vector<unsigned int> oldresult = result;
-    result.clear();
-    if (!optimizer.Run(oldresult.data(), oldresult.size(), &result)) {
+    std::vector<unsigned int> oldresult;
+    oldresult.swap(result);
+    return optimizer.Run(oldresult.data(), oldresult.size(), &result);
+}
+
+SCOPES_RESULT(void) optimize_spirv(spv_target_env env, std::vector<unsigned int> &result, int opt_level) {
+    SCOPES_RESULT_TYPE(void);
+    StyledString log;
+    bool ok = run_optimize_spirv(env, result, opt_level, log);
+    SCOPES_CERR << log._ss.str();
+    if (!ok) {
         SCOPES_ERROR(CGenBackendOptimizationFailed);
     }
-
     SCOPES_CHECK_RESULT(verify_spirv(env, result));
     return {};
 }
 
-SCOPES_RESULT(const String *) compile_spirv(int version, Symbol target, const FunctionRef &fn, uint64_t flags) {
-    SCOPES_RESULT_TYPE(const String *);
-    Timer sum_compile_time(TIMER_CompileSPIRV);
+static std::string run_spirv_to_glsl(std::vector<unsigned int> &&words,
+    int version, bool vulkan_semantics) {
+	spirv_cross::CompilerGLSL glsl(std::move(words));
 
-    //SCOPES_CHECK_RESULT(fn->verify_compilable());
-
-    const spv_target_env env = SPV_ENV_VULKAN_1_1_SPIRV_1_4;
-    SPIRVGenerator ctx(env, version);
-    if (flags & CF_NoDebugInfo) {
-        ctx.use_debug_info = false;
-    }
-
-    std::vector<unsigned int> result;
+    /*
+    // The SPIR-V is now parsed, and we can perform reflection on it.
+    spirv_cross::ShaderResources resources = glsl.get_shader_resources();
+    // Get all sampled images in the shader.
+    for (auto &resource : resources.sampled_images)
     {
-        Timer generate_timer(TIMER_GenerateSPIRV);
-        SCOPES_CHECK_RESULT(
-            ctx.generate(result, target, fn));
-    }
-
+        unsigned set = glsl.get_decoration(resource.id, spv::DecorationDescriptorSet);
+        unsigned binding = glsl.get_decoration(resource.id, spv::DecorationBinding);
+        printf("Image %s at set = %u, binding = %u\n", resource.name.c_str(), set, binding);
 
-    if (flags & CF_O3) {
-        int level = 0;
-        if ((flags & CF_O3) == CF_O1)
-            level = 1;
-        else if ((flags & CF_O3) == CF_O2)
-            level = 2;
-        else if ((flags & CF_O3) == CF_O3)
-            level = 3;
-        SCOPES_CHECK_RESULT(optimize_spirv(env, result, level));
-    }
+        // Modify the decoration to prepare it for GLSL.
+        glsl.unset_decoration(resource.id, spv::DecorationDescriptorSet);
 
-    if (flags & CF_DumpModule) {
-    } else if (flags & CF_DumpFunction) {
-    }
-    if (flags & CF_DumpDisassembly) {
-        disassemble_spirv(result);
+        // Some arbitrary remapping if we want.
+        glsl.set_decoration(resource.id, spv::DecorationBinding, set * 16 + binding);
     }
-
-    size_t bytesize = sizeof(unsigned int) * result.size();
-
-    return String::from((char *)result.data(), bytesize);
-}
-
-const String *spirv_to_glsl(const String *binary) {
-    std::vector<unsigned int> bytes;
-    unsigned int sz = binary->count / sizeof(unsigned int);
-    bytes.resize(sz);
-    memcpy(bytes.data(), binary->data, binary->count);
-
-	spirv_cross::CompilerGLSL glsl(std::move(bytes));
+    */
 
     // Set some options.
     spirv_cross::CompilerGLSL::Options options;
-    options.version = 450;
-    options.vulkan_semantics = true;
-    glsl.build_combined_image_samplers();
+    options.version = version;
+    if (vulkan_semantics) {
+        options.vulkan_semantics = true;
+        glsl.build_combined_image_samplers();
+    }
     glsl.set_common_options(options);
 
     // Compile to GLSL, ready to give to GL driver.
-    std::string source = glsl.compile();
+    return glsl.compile();
+}
 
-    return String::from_stdstring(source);
+static bool use_shader_cache(uint64_t flags) {
+#if SCOPES_ALLOW_CACHE
+    // dumps must see the passes run
+    return !(flags & (CF_DumpDisassembly|CF_DumpModule|CF_DumpFunction));
+#else
+    return false;
+#endif
 }
 
-SCOPES_RESULT(const String *) compile_glsl(int version, Symbol target, const FunctionRef &fn, uint64_t flags) {
-    SCOPES_RESULT_TYPE(const String *);
-    Timer sum_compile_time(TIMER_CompileSPIRV);
+// the unoptimized binary is a structural serialization of the proven
+// function; combine it with everything else that affects the output
+static const String *get_shader_cache_key(const char *kind, int version,
+    Symbol target, spv_target_env env, uint64_t flags,
+    const std::vector<unsigned int> &words) {
+    auto targetname = target.name();
+    uint64_t h = hash_bytes(kind, strlen(kind));
+    h = hash2(h, hash_bytes(targetname->data, targetname->count));
+    h = hash2(h, (uint64_t)version);
+    h = hash2(h, (uint64_t)env);
+    h = hash2(h, flags & SCOPES_CACHE_COMPILER_FLAGS);
+    return get_cache_key(h, (const char *)words.data(),
+        sizeof(unsigned int) * words.size());
+}
 
-    //SCOPES_CHECK_RESULT(fn->verify_compilable());
+static int get_spirv_opt_level(uint64_t flags) {
+    if ((flags & CF_O3) == CF_O1)
+        return 1;
+    else if ((flags & CF_O3) == CF_O2)
+        return 2;
+    else if ((flags & CF_O3) == CF_O3)
+        return 3;
+    return 0;
+}
 
-    spv_target_env env = SPV_ENV_OPENGL_4_5;
+static spv_target_env get_glsl_target_env(int version) {
     switch (version) {
-    case 400: env = SPV_ENV_OPENGL_4_0; break;
-    case 410: env = SPV_ENV_OPENGL_4_1; break;
-    case 420: env = SPV_ENV_OPENGL_4_2; break;
-    case 430: env = SPV_ENV_OPENGL_4_3; break;
-    case 450: env = SPV_ENV_OPENGL_4_5; break;
+    case 400: return SPV_ENV_OPENGL_4_0;
+    case 410: return SPV_ENV_OPENGL_4_1;
+    case 420: return SPV_ENV_OPENGL_4_2;
+    case 430: return SPV_ENV_OPENGL_4_3;
+    case 450: return SPV_ENV_OPENGL_4_5;
     default: break;
     }
+    return SPV_ENV_OPENGL_4_5;
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
 
-    SPIRVGenerator ctx(env, 0);
-    if (flags & CF_NoDebugInfo) {
-        ctx.use_debug_info = false;
+// per-shader state of the compilation pipeline
+struct ShaderBuild {
+    enum Status {
+        Pending,
+        Cached,
+        Done,
+        ValidationFailed,
+        OptimizationFailed,
+    };
+
+    const ShaderJob *job = nullptr;
+    spv_target_env env = SPV_ENV_UNIVERSAL_1_0;
+    const String *key = nullptr;
+    Status status = Pending;
+    std::vector<unsigned int> words;
+    std::string glsl;
+    StyledString log;
+    const String *result = nullptr;
+
+    // runs on a worker thread
+    void run() {
+        if (!validate_spirv(env, words, log)) {
+            status = ValidationFailed;
+            return;
+        }
+        auto flags = job->flags;
+        if (flags & CF_O3) {
+            if (!run_optimize_spirv(env, words, get_spirv_opt_level(flags), log)) {
+                status = OptimizationFailed;
+                return;
+            }
+            if (!validate_spirv(env, words, log)) {
+                status = ValidationFailed;
+                return;
+            }
+        }
+        if (job->glsl) {
+            // keep the binary around for disassembly
+            std::vector<unsigned int> copy;
+            if (flags & CF_DumpDisassembly) {
+                copy = words;
+            }
+            glsl = run_spirv_to_glsl(std::move(words),
+                (job->version <= 0)?450:job->version, false);
+            words = std::move(copy);
+        }
+        status = Done;
     }
+};
 
-    std::vector<unsigned int> result;
-    {
-        Timer generate_timer(TIMER_GenerateSPIRV);
-        SCOPES_CHECK_RESULT(
-            ctx.generate(result, target, fn));
+} // namespace
+
+static int get_shader_thread_count(size_t jobs) {
+    auto count = std::thread::hardware_concurrency();
+    if (!count)
+        count = 1;
+    return (int)std::min<size_t>(count, jobs);
+}
+
+static void run_shader_builds(std::vector<ShaderBuild *> &builds) {
+    std::atomic<size_t> next(0);
+    auto worker = [&builds, &next]() {
+        while (true) {
+            size_t i = next.fetch_add(1);
+            if (i >= builds.size())
+                break;
+            builds[i]->run();
+        }
+    };
+    int numthreads = get_shader_thread_count(builds.size());
+    std::vector<std::thread> threads;
+    for (int i = 1; i < numthreads; ++i) {
+        threads.emplace_back(worker);
     }
+    // the calling thread works along
+    worker();
+    for (auto &&thread : threads) {
+        thread.join();
+    }
+}
+
+SCOPES_RESULT(void) compile_shaders(const std::vector<ShaderJob> &jobs,
+    std::vector<const String *> &results) {
+    SCOPES_RESULT_TYPE(void);
+    Timer sum_compile_time(TIMER_CompileSPIRV);
+
+    // not movable, hence the deque
+    std::deque<ShaderBuild> builds(jobs.size());
+    std::vector<ShaderBuild *> pending;
+
+    // generation touches shared compiler state and runs serially
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        auto &&job = jobs[i];
+        auto &&build = builds[i];
+        build.job = &job;
+        int version = job.version;
+        if (job.glsl) {
+            build.env = get_glsl_target_env(job.version);
+            version = 0;
+        } else {
+            build.env = SPV_ENV_VULKAN_1_1_SPIRV_1_4;
+        }
+
+        //SCOPES_CHECK_RESULT(fn->verify_compilable());
 
-    if (flags & CF_O3) {
-        int level = 0;
-        if ((flags & CF_O3) == CF_O1)
-            level = 1;
-        else if ((flags & CF_O3) == CF_O2)
-            level = 2;
-        else if ((flags & CF_O3) == CF_O3)
-            level = 3;
-        SCOPES_CHECK_RESULT(optimize_spirv(env, result, level));
+        SPIRVGenerator ctx(build.env, version);
+        if (job.flags & CF_NoDebugInfo) {
+            ctx.use_debug_info = false;
+        }
+        {
+            Timer generate_timer(TIMER_GenerateSPIRV);
+            SCOPES_CHECK_RESULT(
+                ctx.generate(build.words, job.target, job.fn));
+        }
+
+        if (use_shader_cache(job.flags)) {
+            build.key = get_shader_cache_key(job.glsl?"glsl":"spirv",
+                job.version, job.target, build.env, job.flags, build.words);
+            build.result = get_cache_content(build.key);
+            if (build.result) {
+                build.status = ShaderBuild::Cached;
+                continue;
+            }
+        }
+        pending.push_back(&build);
     }
 
-    if (flags & CF_DumpDisassembly) {
-        disassemble_spirv(result);
+    // validation, optimization and cross-compilation are independent
+    run_shader_builds(pending);
+
+    // report and store in job order
+    results.clear();
+    results.reserve(jobs.size());
+    for (auto &&build : builds) {
+        auto &&job = *build.job;
+        switch(build.status) {
+        case ShaderBuild::Pending: assert(false); break;
+        case ShaderBuild::Cached: break;
+        case ShaderBuild::ValidationFailed: {
+            disassemble_spirv(build.words, true);
+            SCOPES_CERR << build.log._ss.str();
+            SCOPES_ERROR(CGenBackendValidationFailed);
+        } break;
+        case ShaderBuild::OptimizationFailed: {
+            SCOPES_CERR << build.log._ss.str();
+            SCOPES_ERROR(CGenBackendOptimizationFailed);
+        } break;
+        case ShaderBuild::Done: {
+            SCOPES_CERR << build.log._ss.str();
+            if (job.flags & CF_DumpDisassembly) {
+                disassemble_spirv(build.words);
+            }
+            if (job.glsl) {
+                if (job.flags & (CF_DumpModule|CF_DumpFunction)) {
+                    std::cout << build.glsl << std::endl;
+                }
+                build.result = String::from_stdstring(build.glsl);
+            } else {
+                build.result = String::from(
+                    (const char *)build.words.data(),
+                    sizeof(unsigned int) * build.words.size());
+            }
+            if (build.key) {
+                set_cache(build.key, nullptr, 0,
+                    build.result->data, build.result->count);
+            }
+        } break;
+        }
+        results.push_back(build.result);
     }
+    return {};
+}
 
-	spirv_cross::CompilerGLSL glsl(std::move(result));
+static SCOPES_RESULT(const String *) compile_shader(bool glsl, int version, Symbol target, const FunctionRef &fn, uint64_t flags) {
+    SCOPES_RESULT_TYPE(const String *);
+    std::vector<ShaderJob> jobs = {{ version, target, fn, flags, glsl }};
+    std::vector<const String *> results;
+    SCOPES_CHECK_RESULT(compile_shaders(jobs, results));
+    return results[0];
+}
 
-    /*
-    // The SPIR-V is now parsed, and we can perform reflection on it.
-    spirv_cross::ShaderResources resources = glsl.get_shader_resources();
-    // Get all sampled images in the shader.
-    for (auto &resource : resources.sampled_images)
-    {
-        unsigned set = glsl.get_decoration(resource.id, spv::DecorationDescriptorSet);
-        unsigned binding = glsl.get_decoration(resource.id, spv::DecorationBinding);
-        printf("Image %s at set = %u, binding = %u\n", resource.name.c_str(), set, binding);
+SCOPES_RESULT(const String *) compile_spirv(int version, Symbol target, const FunctionRef &fn, uint64_t flags) {
+    return compile_shader(false, version, target, fn, flags);
+}
 
-        // Modify the decoration to prepare it for GLSL.
-        glsl.unset_decoration(resource.id, spv::DecorationDescriptorSet);
+SCOPES_RESULT(const String *) compile_glsl(int version, Symbol target, const FunctionRef &fn, uint64_t flags) {
+    return compile_shader(true, version, target, fn, flags);
+}
 
-        // Some arbitrary remapping if we want.
-        glsl.set_decoration(resource.id, spv::DecorationBinding, set * 16 + binding);
+const String *spirv_to_glsl(const String *binary) {
+    const String *key = nullptr;
+    bool cache = use_shader_cache(0);
+    if (cache) {
+        const char kind[] = "spirv-to-glsl";
+        key = get_cache_key(hash_bytes(kind, sizeof(kind) - 1),
+            binary->data, binary->count);
+        auto content = get_cache_content(key);
+        if (content)
+            return content;
     }
-    */
 
-    // Set some options.
-    spirv_cross::CompilerGLSL::Options options;
-    options.version = (version <= 0)?450:version;
-    glsl.set_common_options(options);
+    std::vector<unsigned int> bytes;
+    unsigned int sz = binary->count / sizeof(unsigned int);
+    bytes.resize(sz);
+    memcpy(bytes.data(), binary->data, binary->count);
 
-    // Compile to GLSL, ready to give to GL driver.
-    std::string source = glsl.compile();
+    std::string source = run_spirv_to_glsl(std::move(bytes), 450, true);
 
-    if (flags & (CF_DumpModule|CF_DumpFunction)) {
-        std::cout << source << std::endl;
+    if (cache) {
+        set_cache(key, nullptr, 0, source.data(), source.size());
     }
 
     return String::from_stdstring(source);
@@ -17,7 +17,20 @@ namespace scopes {
 
 struct Function;
 
+struct ShaderJob {
+    int version;
+    Symbol target;
+    FunctionRef fn;
+    uint64_t flags;
+    // produce GLSL source instead of a SPIR-V binary
+    bool glsl;
+};
+
 //SCOPES_RESULT(void) optimize_spirv(std::vector<unsigned int> &result, int opt_level);
+// generates all jobs serially, then validates, optimizes and cross-compiles
+// them on a thread pool; results are returned in job order
+SCOPES_RESULT(void) compile_shaders(const std::vector<ShaderJob> &jobs,
+    std::vector<const String *> &results);
 SCOPES_RESULT(const String *) compile_spirv(int version, Symbol target, const FunctionRef &fn, uint64_t flags);
 SCOPES_RESULT(const String *) compile_glsl(int version, Symbol target, const FunctionRef &fn, uint64_t flags);
 
@@ -28,6 +28,7 @@
 #include "hash.hpp"
 #include "value.hpp"
 #include "prover.hpp"
+#include "timer.hpp"
 #include "quote.hpp"
 #include "boot.hpp"
 #include "execution.hpp"
@@ -208,6 +209,16 @@ int sc_cache_misses() {
     return get_cache_misses();
 }
 
+void sc_time_section_begin(const sc_string_t *name) {
+    using namespace scopes;
+    Timer::begin_section(name->data);
+}
+
+void sc_time_section_end() {
+    using namespace scopes;
+    Timer::end_section();
+}
+
 sc_rawstring_i32_array_tuple_t sc_launch_args() {
     using namespace scopes;
     return {(int)scopes_argc, scopes_argv};
@@ -293,6 +304,27 @@ sc_valueref_raises_t sc_compile(sc_valueref_t srcl, uint64_t flags) {
     return convert_result(compile(result, flags));
 }
 
+sc_void_raises_t sc_compile_release(sc_valueref_t value) {
+    using namespace scopes;
+    SCOPES_RESULT_TYPE(void);
+    auto c = SCOPES_C_GET_RESULT(extract_constant(value));
+    auto ptr = c.dyn_cast<ConstPointer>();
+    if (!ptr) {
+        SCOPES_C_ERROR(ConstantValueKindMismatch, VK_ConstPointer, c->kind());
+    }
+    return convert_result(release_compiled(ptr));
+}
+
+sc_int_raises_t sc_compile_collect() {
+    using namespace scopes;
+    return convert_result(collect_compiled());
+}
+
+sc_void_raises_t sc_compile_flush() {
+    using namespace scopes;
+    return convert_result(flush_compiled());
+}
+
 sc_string_raises_t sc_compile_spirv(int version, sc_symbol_t target, sc_valueref_t srcl, uint64_t flags) {
     using namespace scopes;
     SCOPES_RESULT_TYPE(const String *);
@@ -307,6 +339,37 @@ sc_string_raises_t sc_compile_glsl(int version, sc_symbol_t target, sc_valueref_
     return convert_result(compile_glsl(version, Symbol::wrap(target), result, flags));
 }
 
+static sc_void_raises_t compile_shader_batch(bool glsl, int count,
+    const int *versions, const sc_symbol_t *targets, const sc_valueref_t *funcs,
+    const uint64_t *flags, const sc_string_t **results) {
+    using namespace scopes;
+    SCOPES_RESULT_TYPE(void);
+    std::vector<ShaderJob> jobs;
+    jobs.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        auto fn = SCOPES_C_GET_RESULT(extract_function_constant(funcs[i]));
+        jobs.push_back({ versions[i], Symbol::wrap(targets[i]), fn, flags[i], glsl });
+    }
+    std::vector<const String *> compiled;
+    SCOPES_C_CHECK_RESULT(compile_shaders(jobs, compiled));
+    for (int i = 0; i < count; ++i) {
+        results[i] = compiled[i];
+    }
+    return convert_result({});
+}
+
+sc_void_raises_t sc_compile_spirv_batch(int count, const int *versions,
+    const sc_symbol_t *targets, const sc_valueref_t *funcs,
+    const uint64_t *flags, const sc_string_t **results) {
+    return compile_shader_batch(false, count, versions, targets, funcs, flags, results);
+}
+
+sc_void_raises_t sc_compile_glsl_batch(int count, const int *versions,
+    const sc_symbol_t *targets, const sc_valueref_t *funcs,
+    const uint64_t *flags, const sc_string_t **results) {
+    return compile_shader_batch(true, count, versions, targets, funcs, flags, results);
+}
+
 const sc_string_t *sc_spirv_to_glsl(const sc_string_t *binary) {
     using namespace scopes;
     return spirv_to_glsl(binary);
@@ -327,6 +390,51 @@ sc_string_raises_t sc_compile_object_to_buffer(const sc_string_t *target_triple,
     return convert_result(compile_object<const String*>(target_triple, (CompilerFileKind)file_kind, module_name, table, flags));
 }
 
+sc_void_raises_t sc_thin_lto_link(const sc_string_t *target_triple, const sc_list_t *inputs, const sc_string_t *path, uint64_t flags) {
+    using namespace scopes;
+    SCOPES_RESULT_TYPE(void);
+    std::vector<std::string> files;
+    while (inputs) {
+        auto value = SCOPES_C_GET_RESULT(extract_string_constant(inputs->at));
+        files.push_back(value->data);
+        inputs = inputs->next;
+    }
+    int level = 2;
+    if ((flags & CF_O3) == CF_O1)
+        level = 1;
+    else if ((flags & CF_O3) == CF_O3)
+        level = 3;
+    else if ((flags & CF_O3) == CF_O0)
+        level = 0;
+    return convert_result(thin_lto_link(target_triple->data, files, path->data, level));
+}
+
+sc_void_raises_t sc_profile_set_input(const sc_string_t *path) {
+    using namespace scopes;
+    return convert_result(set_profile_input(path->data));
+}
+
+sc_void_raises_t sc_profile_write(const sc_string_t *path) {
+    using namespace scopes;
+    return convert_result(write_profile(path->data));
+}
+
+sc_void_raises_t sc_profile_reset() {
+    using namespace scopes;
+    return convert_result(reset_profile());
+}
+
+sc_size_raises_t sc_profile_entry_count(sc_valueref_t value) {
+    using namespace scopes;
+    SCOPES_RESULT_TYPE(size_t);
+    auto c = SCOPES_C_GET_RESULT(extract_constant(value));
+    auto ptr = c.dyn_cast<ConstPointer>();
+    if (!ptr) {
+        SCOPES_C_ERROR(ConstantValueKindMismatch, VK_ConstPointer, c->kind());
+    }
+    SCOPES_C_RETURN(get_profile_entry_count(ptr->value));
+}
+
 void sc_show_targets() {
     llvm::TargetRegistry::printRegisteredTargetsForVersion(llvm::outs());
 }
@@ -489,6 +597,31 @@ bool sc_is_directory(const sc_string_t *path) {
     return false;
 }
 
+bool sc_is_stream(const sc_string_t *path) {
+    using namespace scopes;
+    return SourceFile::is_stream(path->data);
+}
+
+uint64_t sc_file_stamp(const sc_string_t *path) {
+    using namespace scopes;
+    struct stat s;
+    if( stat(path->data,&s) == 0 ) {
+#if defined(SCOPES_WIN32)
+        uint64_t mtime = (uint64_t)s.st_mtime * 1000000000ull;
+#elif defined(SCOPES_MACOS)
+        uint64_t mtime = (uint64_t)s.st_mtimespec.tv_sec * 1000000000ull
+            + s.st_mtimespec.tv_nsec;
+#else
+        uint64_t mtime = (uint64_t)s.st_mtim.tv_sec * 1000000000ull
+            + s.st_mtim.tv_nsec;
+#endif
+        // size and inode catch edits within the timestamp granularity
+        // and files that were replaced by renaming
+        return hash2(hash2(mtime, (uint64_t)s.st_size), (uint64_t)s.st_ino);
+    }
+    return 0;
+}
+
 // globals
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -2536,6 +2669,8 @@ void init_globals(int argc, char *argv[]) {
 
     DEFINE_EXTERN_C_FUNCTION(sc_compiler_version, arguments_type({TYPE_I32, TYPE_I32, TYPE_I32}));
     DEFINE_EXTERN_C_FUNCTION(sc_cache_misses, TYPE_I32);
+    DEFINE_EXTERN_C_FUNCTION(sc_time_section_begin, _void, TYPE_String);
+    DEFINE_EXTERN_C_FUNCTION(sc_time_section_end, _void);
     DEFINE_RAISING_EXTERN_C_FUNCTION(sc_expand, arguments_type({TYPE_ValueRef, TYPE_List, TYPE_Scope}), TYPE_ValueRef, TYPE_List, TYPE_Scope);
     DEFINE_RAISING_EXTERN_C_FUNCTION(sc_eval, TYPE_ValueRef, TYPE_Anchor, TYPE_List, TYPE_Scope);
     DEFINE_RAISING_EXTERN_C_FUNCTION(sc_eval_stage, TYPE_ValueRef, TYPE_Anchor, TYPE_List, TYPE_Scope);
@@ -2544,12 +2679,27 @@ void init_globals(int argc, char *argv[]) {
     DEFINE_RAISING_EXTERN_C_FUNCTION(sc_typify_template, TYPE_ValueRef, TYPE_ValueRef, TYPE_I32, native_ro_pointer_type(TYPE_Type));
     DEFINE_RAISING_EXTERN_C_FUNCTION(sc_typify, TYPE_ValueRef, TYPE_Closure, TYPE_I32, native_ro_pointer_type(TYPE_Type));
     DEFINE_RAISING_EXTERN_C_FUNCTION(sc_compile, TYPE_ValueRef, TYPE_ValueRef, TYPE_U64);
+    DEFINE_RAISING_EXTERN_C_FUNCTION(sc_compile_release, _void, TYPE_ValueRef);
+    DEFINE_RAISING_EXTERN_C_FUNCTION(sc_compile_collect, TYPE_I32);
+    DEFINE_RAISING_EXTERN_C_FUNCTION(sc_compile_flush, _void);
     DEFINE_RAISING_EXTERN_C_FUNCTION(sc_compile_spirv, TYPE_String, TYPE_I32, TYPE_Symbol, TYPE_ValueRef, TYPE_U64);
     DEFINE_RAISING_EXTERN_C_FUNCTION(sc_compile_glsl, TYPE_String, TYPE_I32, TYPE_Symbol, TYPE_ValueRef, TYPE_U64);
     DEFINE_EXTERN_C_FUNCTION(sc_spirv_to_glsl, TYPE_String, TYPE_String);
+    {
+        const Type *TYPE_I32PP = native_ro_pointer_type(TYPE_I32);
+        const Type *TYPE_SymbolPP = native_ro_pointer_type(TYPE_Symbol);
+        const Type *TYPE_StringPP = native_pointer_type(TYPE_String);
+        DEFINE_RAISING_EXTERN_C_FUNCTION(sc_compile_spirv_batch, _void, TYPE_I32, TYPE_I32PP, TYPE_SymbolPP, TYPE_ValuePP, TYPE_U64PP, TYPE_StringPP);
+        DEFINE_RAISING_EXTERN_C_FUNCTION(sc_compile_glsl_batch, _void, TYPE_I32, TYPE_I32PP, TYPE_SymbolPP, TYPE_ValuePP, TYPE_U64PP, TYPE_StringPP);
+    }
     DEFINE_EXTERN_C_FUNCTION(sc_default_target_triple, TYPE_String);
     DEFINE_RAISING_EXTERN_C_FUNCTION(sc_compile_object, _void, TYPE_String, TYPE_I32, TYPE_String, TYPE_Scope, TYPE_U64);
     DEFINE_RAISING_EXTERN_C_FUNCTION(sc_compile_object_to_buffer, TYPE_String, TYPE_String, TYPE_I32, TYPE_String, TYPE_Scope, TYPE_U64);
+    DEFINE_RAISING_EXTERN_C_FUNCTION(sc_thin_lto_link, _void, TYPE_String, TYPE_List, TYPE_String, TYPE_U64);
+    DEFINE_RAISING_EXTERN_C_FUNCTION(sc_profile_set_input, _void, TYPE_String);
+    DEFINE_RAISING_EXTERN_C_FUNCTION(sc_profile_write, _void, TYPE_String);
+    DEFINE_RAISING_EXTERN_C_FUNCTION(sc_profile_reset, _void);
+    DEFINE_RAISING_EXTERN_C_FUNCTION(sc_profile_entry_count, TYPE_USize, TYPE_ValueRef);
     DEFINE_EXTERN_C_FUNCTION(sc_show_targets, _void);
     DEFINE_EXTERN_C_FUNCTION(sc_enter_solver_cli, _void);
     DEFINE_EXTERN_C_FUNCTION(sc_launch_args, arguments_type({TYPE_I32,native_ro_pointer_type(rawstring)}));
@@ -2661,6 +2811,8 @@ void init_globals(int argc, char *argv[]) {
 
     DEFINE_EXTERN_C_FUNCTION(sc_is_file, TYPE_Bool, TYPE_String);
     DEFINE_EXTERN_C_FUNCTION(sc_is_directory, TYPE_Bool, TYPE_String);
+    DEFINE_EXTERN_C_FUNCTION(sc_is_stream, TYPE_Bool, TYPE_String);
+    DEFINE_EXTERN_C_FUNCTION(sc_file_stamp, TYPE_U64, TYPE_String);
     DEFINE_EXTERN_C_FUNCTION(sc_realpath, TYPE_String, TYPE_String);
     DEFINE_EXTERN_C_FUNCTION(sc_dirname, TYPE_String, TYPE_String);
     DEFINE_EXTERN_C_FUNCTION(sc_basename, TYPE_String, TYPE_String);
@@ -21,6 +21,7 @@ namespace scopes {
 Scope::Scope(const String *_doc, const Scope *_parent) :
     map(nullptr),
     index(0),
+    cache(nullptr),
     name(ConstRef()),
     value(ValueRef()),
     doc(_doc),
@@ -33,6 +34,7 @@ Scope::Scope(const String *_doc, const Scope *_parent) :
 
 Scope::Scope(const ConstRef &_name, const ValueRef &_value, const String *_doc, const Scope *_next) :
     map(nullptr),
+    cache(nullptr),
     name(_name),
     value(_value),
     doc(_doc),
@@ -317,6 +319,69 @@ bool Scope::lookup_local(const ConstRef & name, ValueRef &dest) const {
     return lookup(name, dest, 0);
 }
 
+static ConstRef cached_symbol_key(Scope::CachedSymbol which) {
+    static ConstRef keys[Scope::NumCachedSymbols];
+    if (!keys[which]) {
+        switch(which) {
+        case Scope::CachedSymbolWildcard:
+            keys[which] = ConstInt::symbol_from(SYM_SymbolWildcard); break;
+        case Scope::CachedListWildcard:
+            keys[which] = ConstInt::symbol_from(SYM_ListWildcard); break;
+        default: assert(false); break;
+        }
+    }
+    return keys[which];
+}
+
+void Scope::store_cached(CachedSymbol which, const ScopeMapEntry &entry) const {
+    if (!cache) {
+        cache = new LookupCache();
+    }
+    cache->resolved[which] = true;
+    cache->entries[which] = entry;
+}
+
+bool Scope::lookup_cached(CachedSymbol which, ValueRef &dest, const String *&doc) const {
+    auto key = cached_symbol_key(which);
+    // since any new binding is only a few steps away from a scope that has
+    // already resolved the symbol, misses no longer walk up to the root.
+    ScopeMapEntry entry = { ValueRef(), nullptr };
+    const Scope *self = this;
+    while (self) {
+        if (self->cache && self->cache->resolved[which]) {
+            entry = self->cache->entries[which];
+            break;
+        }
+        if (self->map) {
+            int i = self->map->find_index(key);
+            if (i != -1) {
+                entry = self->map->entries[i].second;
+                break;
+            }
+            self = self->start;
+        }
+        if (self->is_header()) {
+            if (self != this) {
+                // resolve per level, so that sibling scopes share the result
+                self->lookup_cached(which, entry.value, entry.doc);
+                break;
+            }
+        } else if (self->name == key) {
+            // unbinding leaves a scope without value
+            entry = { self->value, self->doc };
+            break;
+        }
+        self = self->next;
+    }
+    store_cached(which, entry);
+    if (entry.value) {
+        dest = entry.value;
+        doc = entry.doc;
+        return true;
+    }
+    return false;
+}
+
 StyledStream &Scope::stream(StyledStream &ss) const {
     size_t totalcount = this->totalcount();
     size_t count = this->count();
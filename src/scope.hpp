@@ -31,12 +31,29 @@ struct Scope {
 public:
     typedef OrderedMap<ConstRef, ScopeMapEntry, ConstRef::Hash> Map;
 
+    // symbols that are looked up for every expanded expression; since scopes
+    // are immutable, their bindings can be remembered per scope
+    enum CachedSymbol {
+        CachedSymbolWildcard,
+        CachedListWildcard,
+
+        NumCachedSymbols
+    };
+
 protected:
+    struct LookupCache {
+        bool resolved[NumCachedSymbols];
+        ScopeMapEntry entries[NumCachedSymbols];
+    };
+
     Scope(const ConstRef &name, const ValueRef &value, const String *doc, const Scope *next);
     Scope(const String *doc, const Scope *parent);
 
+    void store_cached(CachedSymbol which, const ScopeMapEntry &entry) const;
+
     mutable const Map *map;
     mutable size_t index;
+    mutable LookupCache *cache;
 public:
     ConstRef name;
     ValueRef value;
@@ -66,6 +83,9 @@ public:
 
     bool lookup_local(const ConstRef &name, ValueRef &dest) const;
 
+    // same as a full lookup of the symbol
+    bool lookup_cached(CachedSymbol which, ValueRef &dest, const String *&doc) const;
+
     StyledStream &stream(StyledStream &ss) const;
 
     static const Scope *reparent_from(const Scope *content, const Scope *parent);
@@ -10,7 +10,10 @@
 
 #define OPEN_FD _open
 #define CLOSE_FD _close
+#define READ_FD _read
+#define ISATTY_FD _isatty
 #define O_RDONLY _O_RDONLY
+#define STREAM_OPEN_FLAGS _O_RDONLY
 #define LSEEK _lseek
 #else
 #include <sys/mman.h>
@@ -18,10 +21,17 @@
 
 #define OPEN_FD open
 #define CLOSE_FD close
+#define READ_FD read
+#define ISATTY_FD isatty
+#define STREAM_OPEN_FLAGS (O_RDONLY | O_NOCTTY | O_NONBLOCK)
 #define LSEEK lseek
 #endif
 
 #include "source_file.hpp"
+#include "string.hpp"
+
+#include <sys/stat.h>
+#include <vector>
 
 #include <fcntl.h>
 #include <assert.h>
@@ -70,10 +80,47 @@ const char *SourceFile::strptr() {
     return (const char *)ptr;
 }
 
+// pipes and terminals end when the writer is done; other devices such as
+// /dev/zero may never end and are not read at all
+static bool is_stream_fd(int fd, const struct stat &st) {
+    auto mode = st.st_mode & S_IFMT;
+    return (mode == S_IFIFO) || ((mode == S_IFCHR) && ISATTY_FD(fd));
+}
+
+bool SourceFile::is_stream(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+    auto mode = st.st_mode & S_IFMT;
+    if (mode == S_IFIFO)
+        return true;
+    if (mode != S_IFCHR)
+        return false;
+    int fd = ::OPEN_FD(path, STREAM_OPEN_FLAGS);
+    if (fd < 0)
+        return false;
+    bool result = is_stream_fd(fd, st);
+    ::CLOSE_FD(fd);
+    return result;
+}
+
 std::unique_ptr<SourceFile> SourceFile::from_file(Symbol _path) {
     auto file = std::unique_ptr<SourceFile>(new SourceFile(_path));
     file->fd = ::OPEN_FD(_path.name()->data, O_RDONLY);
     if (file->fd >= 0) {
+        struct stat st;
+        if ((fstat(file->fd, &st) == 0) && ((st.st_mode & S_IFMT) != S_IFREG)) {
+            if (!is_stream_fd(file->fd, st)) {
+                file->close();
+                return nullptr;
+            }
+            // pipes and terminals can not be mapped
+            int fd = file->fd;
+            file->fd = -1;
+            auto result = from_fd(_path, fd);
+            ::CLOSE_FD(fd);
+            return result;
+        }
         file->length = LSEEK(file->fd, 0, SEEK_END);
         if (file->length) {
             file->ptr = mmap(nullptr,
@@ -100,6 +147,25 @@ std::unique_ptr<SourceFile> SourceFile::from_string(Symbol _path, const String *
     return std::unique_ptr<SourceFile>(file);
 }
 
+std::unique_ptr<SourceFile> SourceFile::from_fd(Symbol _path, int fd) {
+    // read until the stream is exhausted; the buffer is kept alive by the
+    // anchors so that error messages can still display the source
+    std::vector<char> buf;
+    const size_t chunk_size = 65536;
+    while (true) {
+        auto offset = buf.size();
+        buf.resize(offset + chunk_size);
+        auto count = ::READ_FD(fd, buf.data() + offset, chunk_size);
+        if (count < 0) {
+            return nullptr;
+        }
+        buf.resize(offset + count);
+        if (!count)
+            break;
+    }
+    return from_string(_path, String::from(buf.data(), buf.size()));
+}
+
 size_t SourceFile::size() const {
     return length;
 }
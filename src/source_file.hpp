@@ -37,6 +37,13 @@ public:
 
     static std::unique_ptr<SourceFile> from_file(Symbol _path);
 
+    // true for pipes and terminals, which from_file reads through from_fd
+    static bool is_stream(const char *path);
+
+    // reads a stream that can not be mapped (pipe, terminal) to its end;
+    // fd is not closed
+    static std::unique_ptr<SourceFile> from_fd(Symbol _path, int fd);
+
     static std::unique_ptr<SourceFile> from_string(Symbol _path, const String *str);
 
     size_t size() const;
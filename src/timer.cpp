@@ -5,8 +5,31 @@
 */
 
 #include "timer.hpp"
+#include "cache.hpp"
+#include "styled_stream.hpp"
 #include "absl/container/flat_hash_map.h"
 
+#include "llvm/IR/PassTimingInfo.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#ifdef SCOPES_WIN32
+#include "wininclude.h"
+#include <psapi.h>
+#elif defined(SCOPES_MACOS)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#else
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
 namespace scopes {
 
 struct TimerData {
@@ -59,4 +82,265 @@ void Timer::print_timers() {
     ss << "cumulative user: " << (real_sum - non_user_sum) << "ms" << std::endl;
 }
 
+//------------------------------------------------------------------------------
+// TIME REPORT
+//------------------------------------------------------------------------------
+
+typedef std::vector< std::pair<Symbol, double> > TimerTotals;
+
+struct SectionData {
+    std::string name;
+    int depth;
+    double start;
+    double wall;
+    size_t memory_begin;
+    size_t memory_end;
+    // totals when the section began, replaced by the time spent in it
+    TimerTotals timers;
+};
+
+static bool report_active = false;
+static bool report_json = false;
+static std::vector<SectionData> sections;
+static std::vector<size_t> open_sections;
+static auto report_start = std::chrono::high_resolution_clock::now();
+
+static double report_time() {
+    std::chrono::duration<double> diff =
+        std::chrono::high_resolution_clock::now() - report_start;
+    return diff.count() * 1000.0;
+}
+
+static size_t resident_memory() {
+#ifdef SCOPES_WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return pmc.WorkingSetSize;
+    return 0;
+#elif defined(SCOPES_MACOS)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+        (task_info_t)&info, &count) == KERN_SUCCESS)
+        return info.resident_size;
+    return 0;
+#else
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return 0;
+    long size = 0;
+    long resident = 0;
+    int count = fscanf(f, "%ld %ld", &size, &resident);
+    fclose(f);
+    if (count != 2)
+        return 0;
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+static size_t peak_memory() {
+#ifdef SCOPES_WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return pmc.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+#ifdef SCOPES_MACOS
+    return (size_t)usage.ru_maxrss;
+#else
+    // reported in kilobytes
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// the running timer only adds its time when it is paused
+static TimerTotals timer_totals() {
+    if (active_timer) {
+        active_timer->pause();
+        active_timer->resume();
+    }
+    TimerTotals result;
+    for (auto &&it : timers) {
+        result.push_back({it.first, it.second.time});
+    }
+    return result;
+}
+
+void Timer::enable_report(bool json) {
+    report_active = true;
+    report_json = json;
+    llvm::TimePassesIsEnabled = true;
+}
+
+bool Timer::report_enabled() {
+    return report_active;
+}
+
+void Timer::begin_section(const char *name) {
+    if (!report_active)
+        return;
+    SectionData section;
+    section.name = name;
+    section.depth = (int)open_sections.size();
+    section.start = report_time();
+    section.wall = 0.0;
+    section.memory_begin = resident_memory();
+    section.memory_end = 0;
+    section.timers = timer_totals();
+    open_sections.push_back(sections.size());
+    sections.push_back(std::move(section));
+}
+
+void Timer::end_section() {
+    if (open_sections.empty())
+        return;
+    auto &section = sections[open_sections.back()];
+    open_sections.pop_back();
+    section.wall = report_time() - section.start;
+    section.memory_end = resident_memory();
+    TimerTotals spent;
+    for (auto &&it : timer_totals()) {
+        double before = 0.0;
+        for (auto &&prev : section.timers) {
+            if (prev.first == it.first) {
+                before = prev.second;
+                break;
+            }
+        }
+        if (it.second > before) {
+            spent.push_back({it.first, it.second - before});
+        }
+    }
+    section.timers = std::move(spent);
+}
+
+void Timer::end_open_sections() {
+    while (!open_sections.empty()) {
+        end_section();
+    }
+}
+
+static void print_json_string(llvm::raw_ostream &os, const char *s) {
+    os << '"';
+    for (; *s; ++s) {
+        unsigned char c = *s;
+        switch(c) {
+        case '"': os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\t': os << "\\t"; break;
+        default:
+            if (c < 0x20) {
+                os << llvm::format("\\u%04x", c);
+            } else {
+                os << (char)c;
+            }
+        }
+    }
+    os << '"';
+}
+
+static double megabytes(size_t bytes) {
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+static void print_text_report(llvm::raw_ostream &os, int hits, int misses) {
+    os << "time report (ms, MB)\n";
+    os << llvm::left_justify("section", 48)
+        << llvm::right_justify("start", 11) << llvm::right_justify("wall", 11)
+        << llvm::right_justify("memory", 10) << llvm::right_justify("+memory", 10)
+        << "\n";
+    for (auto &&section : sections) {
+        std::string name(section.depth * 2, ' ');
+        name += section.name;
+        os << llvm::format("%-48s %10.3f %10.3f %9.2f %+9.2f\n",
+            name.c_str(), section.start, section.wall,
+            megabytes(section.memory_end),
+            megabytes(section.memory_end) - megabytes(section.memory_begin));
+        for (auto &&it : section.timers) {
+            std::string label(section.depth * 2 + 4, ' ');
+            label += it.first.name()->data;
+            // leaves the start column empty
+            os << llvm::format("%-59s %10.3f\n", label.c_str(), it.second);
+        }
+    }
+    os << "timers:\n";
+    for (auto &&it : timers) {
+        os << llvm::format("    %-44s %10.3f\n", it.first.name()->data, it.second.time);
+    }
+    os << llvm::format("cache: %d hits, %d misses\n", hits, misses);
+    os << llvm::format("peak memory: %.2f MB\n", megabytes(peak_memory()));
+    llvm::reportAndResetTimings(&os);
+}
+
+static void print_json_report(llvm::raw_ostream &os, int hits, int misses) {
+    os << "{\n\"sections\": [";
+    const char *delim = "\n";
+    for (auto &&section : sections) {
+        os << delim << "\t{\"name\": ";
+        delim = ",\n";
+        print_json_string(os, section.name.c_str());
+        os << llvm::format(", \"depth\": %d, \"start_ms\": %.3f, \"wall_ms\": %.3f",
+            section.depth, section.start, section.wall);
+        os << ", \"memory_begin\": " << (uint64_t)section.memory_begin
+            << ", \"memory_end\": " << (uint64_t)section.memory_end
+            << ", \"timers\": {";
+        const char *timer_delim = "";
+        for (auto &&it : section.timers) {
+            os << timer_delim;
+            timer_delim = ", ";
+            print_json_string(os, it.first.name()->data);
+            os << llvm::format(": %.3f", it.second);
+        }
+        os << "}}";
+    }
+    os << "\n],\n\"timers\": {";
+    delim = "\n";
+    for (auto &&it : timers) {
+        os << delim << "\t";
+        delim = ",\n";
+        print_json_string(os, it.first.name()->data);
+        os << llvm::format(": %.3f", it.second.time);
+    }
+    os << "\n},\n\"cache\": {\"hits\": " << hits
+        << ", \"misses\": " << misses << "},\n";
+    os << "\"peak_memory\": " << (uint64_t)peak_memory() << ",\n";
+    os << "\"passes\": {\n";
+    llvm::TimerGroup::printAllJSONValues(os, "");
+    llvm::TimerGroup::clearAll();
+    os << "\n}\n}\n";
+}
+
+void Timer::print_report() {
+    if (!report_active)
+        return;
+    end_open_sections();
+    int hits = 0;
+    int misses = 0;
+    get_cache_totals(hits, misses);
+    std::string report;
+    {
+        llvm::raw_string_ostream os(report);
+        if (report_json) {
+            print_json_report(os, hits, misses);
+        } else {
+            print_text_report(os, hits, misses);
+        }
+    }
+    StyledStream ss(SCOPES_CERR);
+    ss << report;
+}
+
+TimerSection::TimerSection(const char *name) {
+    Timer::begin_section(name);
+}
+
+TimerSection::~TimerSection() {
+    Timer::end_section();
+}
+
 } // namespace scopes
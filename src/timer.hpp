@@ -30,6 +30,22 @@ struct Timer {
     void resume();
 
     static void print_timers();
+
+    // the time report breaks the run down into named sections and is
+    // printed on shutdown, either as text or as JSON
+    static void enable_report(bool json);
+    static bool report_enabled();
+    static void begin_section(const char *name);
+    static void end_section();
+    // closes all sections that are still open
+    static void end_open_sections();
+    static void print_report();
+};
+
+// times the enclosing scope as a section of the time report
+struct TimerSection {
+    TimerSection(const char *name);
+    ~TimerSection();
 };
 
 } // namespace scopes
@@ -0,0 +1,15 @@
+#
+    runs all benchmarks; set SCOPES_BENCH_JSON to a file path to collect the
+    results of `bench` in JSON format
+
+using import testing
+
+bench-modules
+    .bench_arc
+    .bench_concurrent_map
+    .bench_format
+    .bench_glm
+    .bench_itertools
+    .bench_raise
+    .bench_sort
+    .bench_string
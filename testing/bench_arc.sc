@@ -0,0 +1,51 @@
+#
+    measures the cost of copying and dropping handles to a shared value from
+    multiple threads
+
+    run with: scopes testing/bench_arc.sc [thread count] [iterations]
+
+using import testing
+using import Capture
+using import parallel
+using import Rc
+
+vvv bind C
+include
+    """"#include <stdlib.h>
+
+let MAX_THREADS = 64
+
+let source-path argc argv = (script-launch-args)
+let thread-count =
+    if (argc > 0)
+        min ((C.extern.atoi (argv @ 0)) as i32) MAX_THREADS
+    else 4
+global iterations = 100000
+if (argc > 1)
+    iterations = ((C.extern.atoi (argv @ 1)) as i32)
+
+let SharedType = (Arc i32)
+
+fn worker (handle)
+    for i in (range (deref iterations))
+        let h = (copy handle)
+        assert (h == 303)
+
+fn run (thread-count)
+    local handle = (SharedType 303)
+    let ptr = (& handle)
+    let seconds =
+        bench (.. (tostring thread-count) " threads")
+            run-threads thread-count
+                capture (i) {ptr}
+                    worker (@ ptr)
+    assert ((Rc.strong-count handle) == 1) "refcount is unbalanced"
+    let ops = ((thread-count * iterations * 2) as f64)
+    print "   " (seconds * 1e9 / ops) "ns per refcount update"
+
+print "copying and dropping" iterations "handles per thread"
+loop (n = 1)
+    if (n > thread-count)
+        break;
+    run n
+    n * 2
@@ -0,0 +1,55 @@
+#
+    measures how lookups and updates of ConcurrentMap scale with the number
+    of threads, for several ratios of reads to writes; every sample runs
+    `OPS` operations on each of exactly that many OS threads, so counts
+    beyond the number of processors measure oversubscription.
+
+    run with: scopes testing/bench_concurrent_map.sc
+
+using import testing
+using import Capture
+using import parallel
+using import ConcurrentMap
+
+let KEYS = 65536:u32
+let OPS = 262144
+
+fn xorshift (state)
+    let state = (state ^ (state << 13:u32))
+    let state = (state ^ (state >> 17:u32))
+    state ^ (state << 5:u32)
+
+local map : (ConcurrentMap u32 u32)
+for i in (range KEYS)
+    'set map i i
+let ptr = (& map)
+
+# operations of thread `index`; `read-percent` of them are lookups
+fn run-ops (map index read-percent)
+    loop (i state found = 0 ((index as u32) * 2654435761:u32 + 1:u32) 0:u32)
+        if (i == OPS)
+            break found
+        let state = (xorshift state)
+        let key = (state % KEYS)
+        let read? = (((state >> 16:u32) % 100:u32) < read-percent)
+        _ (i + 1) state
+            if read?
+                found + ('getdefault map key 0:u32)
+            else
+                'set map key state
+                found
+
+inline bench-scaling (read-percent)
+    va-map
+        inline (threads)
+            bench
+                .. (tostring read-percent) "% reads, " (tostring threads) " threads"
+                run-threads threads
+                    capture (i) {ptr read-percent}
+                        black-box (run-ops (@ ptr) i read-percent)
+                        ;
+        \ 1 2 4 8 16 32
+
+bench-scaling 50:u32
+bench-scaling 90:u32
+bench-scaling 99:u32
@@ -0,0 +1,23 @@
+#
+    compares building a log line with `format` against writing it with
+    `format-into`
+
+    run with: scopes testing/bench_format.sc
+
+using import testing
+using import format
+using import String
+
+bench "format into String"
+    let s = (String (format "[{}] request {} took {} ms ({})" 3 (black-box 12345) 1.25 "ok"))
+    black-box (countof s)
+
+bench "format-into stack buffer"
+    local buf : (array i8 128)
+    black-box
+        format-into buf "[{}] request {} took {} ms ({})" 3 (black-box 12345) 1.25 "ok"
+
+bench "format-into String"
+    local s : String
+    black-box
+        format-into s "[{}] request {} took {} ms ({})" 3 (black-box 12345) 1.25 "ok"
@@ -0,0 +1,118 @@
+#
+    measures throughput of batched vector transforms and matrix palette
+    skinning with the glm matrix kernels
+
+    run with: scopes testing/bench_glm.sc [vertex count]
+
+using import testing
+using import glm
+
+vvv bind C
+include
+    """"#include <stdlib.h>
+
+let source-path argc argv = (script-launch-args)
+let N =
+    if (argc > 0)
+        (C.extern.atoi (argv @ 0)) as usize
+    else 1000000:usize
+let BONES = 64:u32
+
+inline measure (name f)
+    let seconds =
+        bench name
+            f;
+    print "    " ((f64 N) / seconds / 1000000.0) "Mvertices/s"
+
+fn xorshift (state)
+    let state = (state ^ (state << 13:u32))
+    let state = (state ^ (state >> 17:u32))
+    state ^ (state << 5:u32)
+
+# the product spelled out element by element, as a reference
+inline scalar-transform (m v)
+    let c0 c1 c2 c3 = (unpack m)
+    vec4
+        c0.x * v.x + c1.x * v.y + c2.x * v.z + c3.x * v.w
+        c0.y * v.x + c1.y * v.y + c2.y * v.z + c3.y * v.w
+        c0.z * v.x + c1.z * v.y + c2.z * v.z + c3.z * v.w
+        c0.w * v.x + c1.w * v.y + c2.w * v.z + c3.w * v.w
+
+let src = (malloc-array vec4 N)
+let dest = (malloc-array vec4 N)
+let positions = (malloc-array vec3 N)
+let skinned = (malloc-array vec3 N)
+let bone-ids = (malloc-array uvec4 N)
+let weights = (malloc-array vec4 N)
+let bones = (malloc-array mat4x3 BONES)
+
+loop (i state = 0:usize 2463534242:u32)
+    if (i == N)
+        break;
+    let x = (f32 (state & 0xffff:u32))
+    src @ i = (vec4 x (x * 0.5) (x * 0.25) 1)
+    positions @ i = (vec3 x (x * 0.5) (x * 0.25))
+    bone-ids @ i =
+        uvec4
+            state % BONES
+            (state >> 8:u32) % BONES
+            (state >> 16:u32) % BONES
+            (state >> 24:u32) % BONES
+    weights @ i = (vec4 0.4 0.3 0.2 0.1)
+    _ (i + 1:usize) (xorshift state)
+
+for i in (range BONES)
+    let s = (f32 i)
+    bones @ i =
+        mat4x3
+            vec3 1 0 (s * 0.01)
+            vec3 0 1 0
+            vec3 (- (s * 0.01)) 0 1
+            vec3 s (s * 2.0) (s * 3.0)
+
+let m =
+    mat4
+        vec4 0.8 0.1 0 0
+        vec4 -0.1 0.8 0 0
+        vec4 0 0 1 0
+        vec4 10 20 30 1
+
+print "transforming" N "vertices"
+measure "scalar mat4 * vec4"
+    inline ()
+        for i in (range N)
+            dest @ i = (scalar-transform m (src @ i))
+measure "transform-many"
+    inline ()
+        transform-many m src dest N
+measure "transform-points mat4x3"
+    inline ()
+        transform-points (mat4x3 m) positions skinned N
+measure "skinning, 4 bones"
+    inline ()
+        for i in (range N)
+            let ids = (bone-ids @ i)
+            let w = (weights @ i)
+            inline weighted (k)
+                let b = (bones @ (ids @ k))
+                let wk = (w @ k)
+                _ ((b @ 0) * wk) ((b @ 1) * wk) ((b @ 2) * wk) ((b @ 3) * wk)
+            let a0 a1 a2 a3 = (weighted 0)
+            let b0 b1 b2 b3 = (weighted 1)
+            let c0 c1 c2 c3 = (weighted 2)
+            let d0 d1 d2 d3 = (weighted 3)
+            let blended =
+                mat4x3
+                    a0 + b0 + c0 + d0
+                    a1 + b1 + c1 + d1
+                    a2 + b2 + c2 + d2
+                    a3 + b3 + c3 + d3
+            skinned @ i = blended * (vec4 (positions @ i) 1)
+
+free src
+free dest
+free positions
+free skinned
+free bone-ids
+free weights
+free bones
@@ -0,0 +1,43 @@
+#
+    compares reductions and element-wise kernels written with generators
+    against the counted sequences of itertools
+
+    run with: scopes testing/bench_itertools.sc
+
+using import testing
+using import itertools
+
+let N = (1:usize << 16:usize)
+
+global xs : (array f32 N)
+global ys : (array f32 N)
+for i in (range N)
+    xs @ i = ((i % 17:usize) as f32)
+    ys @ i = ((i % 13:usize) as f32)
+
+bench "sum generator"
+    black-box
+        fold (acc = 0.0) for x in xs
+            acc + x
+bench "sum counted"
+    black-box (reduce 0.0 (do +) xs)
+bench "sum counted vectorize 8"
+    black-box (reduce 0.0 (do +) (vectorize 8 xs))
+
+bench "dot generator"
+    black-box
+        fold (acc = 0.0) for i in (range N)
+            acc + (xs @ i) * (ys @ i)
+bench "dot counted"
+    black-box (reduce 0.0 (do +) (cmap (do *) xs ys))
+bench "dot counted vectorize 8"
+    black-box (reduce 0.0 (do +) (vectorize 8 (cmap (do *) xs ys)))
+
+let a = 0.5
+bench "saxpy generator"
+    for i in (range N)
+        ys @ i = a * (xs @ i) + (ys @ i)
+    black-box (ys @ 0)
+bench "saxpy counted"
+    black-box
+        write-into (cmap (inline (x y) (a * x + y)) xs ys) ys
@@ -0,0 +1,32 @@
+#
+    compares an inner loop that calls a raising function against the same
+    loop without error checks; the error path should not slow it down
+
+    run with: scopes testing/bench_raise.sc
+
+using import testing
+
+let N = (1:usize << 16:usize)
+
+global xs : (array i32 N)
+for i in (range N)
+    xs @ i = ((i % 251:usize) as i32)
+
+fn checked-scale (x)
+    if (x < 0)
+        raise "negative value"
+    x * 3
+
+fn unchecked-scale (x)
+    x * 3
+
+bench "sum unchecked"
+    black-box
+        fold (acc = 0) for x in xs
+            acc + (unchecked-scale x)
+bench "sum checked"
+    black-box
+        try
+            fold (acc = 0) for x in xs
+                acc + (checked-scale x)
+        except (err) -1
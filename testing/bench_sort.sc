@@ -0,0 +1,96 @@
+#
+    compares the sorting algorithms of Array against C's qsort
+
+    run with: scopes testing/bench_sort.sc [element count]
+
+    every run sorts a fresh copy of the input; the "copy only" line measures
+    that copy on its own.
+
+using import testing
+using import Array
+
+vvv bind C
+include
+    """"#include <stdlib.h>
+
+        int bench_compare_i32(const void *a, const void *b) {
+            int x = *(const int *)a;
+            int y = *(const int *)b;
+            return (x > y) - (x < y);
+        }
+
+let source-path argc argv = (script-launch-args)
+let N =
+    if (argc > 0)
+        (C.extern.atoi (argv @ 0)) as usize
+    else 100000:usize
+
+fn xorshift (state)
+    let state = (state ^ (state << 13:u32))
+    let state = (state ^ (state >> 17:u32))
+    state ^ (state << 5:u32)
+
+inline fill-random (a)
+    'clear a
+    loop (i state = 0:usize 2463534242:u32)
+        if (i == N)
+            break;
+        'append a ((xorshift state) as i32)
+        _ (i + 1:usize) (xorshift state)
+
+inline fill-sorted (a)
+    'clear a
+    for i in (range N)
+        'append a (i as i32)
+
+inline fill-reversed (a)
+    'clear a
+    for i in (range N)
+        'append a ((N - i) as i32)
+
+inline fill-few-unique (a)
+    'clear a
+    loop (i state = 0:usize 88172645:u32)
+        if (i == N)
+            break;
+        'append a (((xorshift state) % 16:u32) as i32)
+        _ (i + 1:usize) (xorshift state)
+
+fn verify (a)
+    for i in (range 1:usize (countof a))
+        assert ((a @ (i - 1:usize)) <= (a @ i)) "array is not sorted"
+
+inline run-suite (title fill)
+    local input : (Array i32)
+    fill input
+    local a : (Array i32)
+    inline measure (name f)
+        bench (.. title ", " name)
+            'clear a
+            for x in input
+                'append a x
+            f a
+            black-box (deref (a @ 0:usize))
+    measure "copy only"
+        inline (a) (_)
+    measure "qsort"
+        inline (a)
+            C.extern.qsort (bitcast (deref a._items) (mutable voidstar))
+                (countof a) (sizeof i32)
+                C.extern.bench_compare_i32
+    verify a
+    measure "sort"
+        inline (a) ('sort a)
+    verify a
+    measure "stable-sort"
+        inline (a) ('stable-sort a)
+    verify a
+    measure "radix-sort"
+        inline (a) ('radix-sort a)
+    verify a
+
+print "sorting" N "elements of i32"
+run-suite "random" fill-random
+run-suite "sorted" fill-sorted
+run-suite "reversed" fill-reversed
+run-suite "few unique" fill-few-unique
@@ -0,0 +1,42 @@
+#
+    measures short string churn and substring search of String
+
+    run with: scopes testing/bench_string.sc
+
+using import testing
+using import String
+
+fn naive-find (s needle)
+    let size = (countof s)
+    let count = (countof needle)
+    loop (i = 0:usize)
+        if ((i + count) > size)
+            break -1:usize
+        let found? =
+            loop (j = 0:usize)
+                if (j == count)
+                    break true
+                if ((s @ (i + j)) != (needle @ j))
+                    break false
+                j + 1:usize
+        if found?
+            break i
+        i + 1:usize
+
+bench "short string construct + copy + drop"
+    local s = (String "key")
+    'append s "-name"
+    let t = (copy s)
+    black-box (countof t)
+
+# one megabyte of text with the needle at the very end
+local haystack : String
+for i in (range (1:usize << 20:usize))
+    'append haystack (((i % 26:usize) + 97:usize) as i8)
+'append haystack "needle"
+local needle = (String "needle")
+
+bench "naive search in 1 MB"
+    black-box (naive-find haystack needle)
+bench "find in 1 MB"
+    black-box ('find haystack needle)
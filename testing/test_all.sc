@@ -22,10 +22,13 @@ test-modules
     .test_clang
     .test_closure
     .test_codegen
+    .test_cold_paths
+    .test_concurrent_map
     .test_conversion
     .test_convert
     .test_copy
     .test_currying
+    .test_debug_info
     .test_decorator
     .test_defer
     .test_dispatch
@@ -55,6 +58,8 @@ test-modules
     .test_intrinsics
     .test_iter2
     .test_itertools
+    .test_jit_batch
+    .test_jit_collect
     .test_label
     .test_let
     .test_local
@@ -71,7 +76,10 @@ test-modules
     .test_operators
     .test_option
     .test_overload
+    .test_parallel
+    .test_parallel_codegen
     .test_parser
+    .test_pgo
     .test_pointer
     .test_print
     .test_property
@@ -80,6 +88,7 @@ test-modules
     .test_recursion
     .test_reference
     .test_regexp
+    .test_reload
     .test_scope_iter
     .test_scope
     .test_semicolon
@@ -91,6 +100,7 @@ test-modules
     .test_sugar
     .test_switch
     .test_testing
+    .test_thin_lto
     .test_try
     .test_tuple_array
     .test_typecast
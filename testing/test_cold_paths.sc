@@ -0,0 +1,45 @@
+using import testing
+using import C.stdio
+using import C.stdlib
+
+# the module is dumped to stderr by a separate process, so that the dump can
+    be written to a file and searched
+let script-path = (module-dir .. "/_test_cold_paths.sc")
+let dump-path = (module-dir .. "/_test_cold_paths.ll")
+
+let script =
+    """"fn fail (x)
+            raise x
+        fn checked-scale (x)
+            if (x < 0)
+                fail x
+            x * 3
+        fn sum (n)
+            try
+                fold (acc = 0) for i in (range n)
+                    acc + (checked-scale i)
+            except (err) -1
+        compile (typify sum i32) 'dump-module
+
+let f = (fopen script-path "wb")
+fwrite (script as rawstring) 1 (countof script) f
+fclose f
+remove dump-path
+
+inline shell (cmd)
+    (system (report cmd)) == 0
+
+test (shell (.. compiler-path " " script-path " 2> " dump-path))
+# the checks after the raising call in the loop expect no error
+test (shell (.. "grep -q '!prof ![0-9]*' " dump-path))
+test (shell (.. "grep -q 'branch_weights\", i32 2000, i32 1' " dump-path))
+# the function that can only raise is an error path
+let attrs =
+    .. "a=$(grep -E '^define .*fail<i32>' " dump-path
+        " | grep -oE '#[0-9]+' | head -n 1)"
+let is-cold =
+    .. " && test -n \"$a\" && grep -qE \"^attributes $a = \\{.*cold\" " dump-path
+test (shell (.. attrs is-cold))
+
+remove script-path
+remove dump-path
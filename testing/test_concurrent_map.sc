@@ -0,0 +1,52 @@
+using import testing
+using import Capture
+using import parallel
+using import ConcurrentMap
+
+do
+    local map : (ConcurrentMap i32 i32)
+    for i in (range 1000)
+        'set map i (i * 2)
+    test ((countof map) == 1000)
+    test (('get map 500) == 1000)
+    test (500 in map)
+    test (not (1000 in map))
+    test (('getdefault map 1000 -1) == -1)
+    test-error ('get map 1000)
+
+    'set map 500 7
+    test (('get map 500) == 7)
+    test (('pop map 500) == 7)
+    test (not (500 in map))
+    'discard map 501
+    test ((countof map) == 998)
+
+    # the constructor only runs for missing keys
+    test (('get-or-insert map 0 (inline (key) 99)) == 0)
+    test (('get-or-insert map 500 (inline (key) (key + 1))) == 501)
+    test (('get map 500) == 501)
+
+    local sum = 0
+    'for-each map
+        inline (key value)
+            sum += value
+    test (sum == (999 * 1000 - 1000 - 1002 + 501))
+
+    'clear map
+    test ((countof map) == 0)
+
+# concurrent writers and readers
+do
+    local map : (ConcurrentMap i32 i32)
+    let ptr = (& map)
+    let N = 10000
+    parallel-for N
+        capture (i) {ptr}
+            let i = (i as i32)
+            'set (@ ptr) i i
+            'get-or-insert (@ ptr) (i // 2)
+                inline (key) (key * 3)
+            ;
+    test ((countof map) == N)
+    for i in (range N)
+        test (('get map i) == i)
@@ -0,0 +1,86 @@
+using import testing
+using import struct
+using import C.stdio
+using import C.stdlib
+
+struct Point plain
+    x : f32
+    y : f32
+
+fn length2 (p)
+    let sq = (p.x * p.x)
+    sq + p.y * p.y
+
+fn helper (x)
+    x * 2.0
+
+fn scale (p s)
+    Point (helper (p.x * s)) (p.y * s)
+
+inline shell (cmd)
+    (system (report cmd)) == 0
+
+inline contains? (path pattern)
+    shell (.. "grep -q '" pattern "' " path)
+
+let f = ((compile (typify length2 Point)) as (pointer (function f32 Point)))
+test ((f (Point 3.0 4.0)) == 25.0)
+
+# JIT compiled functions only carry line tables; the module is dumped to
+    stderr by a separate process, so that the dump can be searched
+let script-path = (module-dir .. "/_test_debug_info.sc")
+let jit-path = (module-dir .. "/_test_debug_info_jit.ll")
+let script =
+    """"using import struct
+        struct Point plain
+            x : f32
+            y : f32
+        fn length2 (p)
+            let sq = (p.x * p.x)
+            sq + p.y * p.y
+        compile (typify length2 Point) 'dump-module
+let script-file = (fopen script-path "wb")
+fwrite (script as rawstring) 1 (countof script) script-file
+fclose script-file
+remove jit-path
+test (shell (.. compiler-path " " script-path " 2> " jit-path))
+test (contains? jit-path "emissionKind: LineTablesOnly")
+test (contains? jit-path "DISubprogram")
+test (not (contains? jit-path "DILocalVariable"))
+test (not (contains? jit-path "DICompositeType"))
+remove script-path
+remove jit-path
+
+# exported functions describe their types and variables; helper does not
+let full-path = (module-dir .. "/test_debug_info.ll")
+remove full-path
+compile-object
+    default-target-triple
+    compiler-file-kind-llvm
+    full-path
+    do
+        let length2 = (static-typify length2 Point)
+        let scale = (static-typify scale Point f32)
+        locals;
+    'full-debug-info
+test (contains? full-path "emissionKind: FullDebug")
+test (contains? full-path "DICompositeType(tag: DW_TAG_structure_type")
+test (contains? full-path "DILocalVariable(name: \"p\", arg: 1")
+test (contains? full-path "DILocalVariable(name: \"s\", arg: 2")
+test (not (contains? full-path "DILocalVariable(name: \"x\""))
+
+# full debug info is ignored when debug info is disabled
+let none-path = (module-dir .. "/test_debug_info_none.ll")
+remove none-path
+compile-object
+    default-target-triple
+    compiler-file-kind-llvm
+    none-path
+    do
+        let length2 = (static-typify length2 Point)
+        locals;
+    'no-debug-info
+    'full-debug-info
+test (contains? none-path "define")
+test (not (contains? none-path "DICompileUnit"))
+test (not (contains? none-path "DILocalVariable"))
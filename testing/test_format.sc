@@ -42,5 +42,64 @@ test-compiler-error
 test-compiler-error
     format "test {x}"
 
+# formatting without allocations
+
+do
+    local buf : (array i8 64)
+    let n =
+        format-into buf "x = {}, n = {}, {b} {}" 1.5 -42 "end"
+            b = true
+    test (n == 26)
+    test ((string (& (buf @ 0)) n) == "x = 1.5, n = -42, true end")
+
+    # output is truncated and zero-terminated
+    local small : (array i8 8)
+    let n = (format-into small "{}-{}" 123456 789)
+    test (n == 10)
+    test ((string (& (small @ 0)) 7:usize) == "123456-")
+    test ((small @ 7) == 0:i8)
+
+    inline check (expected args...)
+        local buf : (array i8 64)
+        let n = (format-into buf args...)
+        test ((string (& (buf @ 0)) n) == expected)
+
+    check "0 7 99 100 -1" "{} {} {} {} {}" 0 7 99 100 -1
+    check "-2147483648 18446744073709551615 -9223372036854775808"
+        \ "{} {} {}" (-2147483647 - 1) -1:u64 (-9223372036854775807:i64 - 1:i64)
+    check "0.1 1.0 0.33333334 1e+20 -2.5" "{} {} {} {} {}"
+        \ 0.1 1.0 (1.0 / 3.0) 1e20:f64 -2.5:f64
+    check "false" "{}" false
+
+    local s : String "("
+    format-into s "{}/{}/{})" "a" (String "b") 3
+    test (s == "(a/b/3)")
+
+    # a char array is written up to its first zero, not to its capacity
+    local name : (array i8 16)
+    name @ 0 = 111:i8
+    name @ 1 = 107:i8
+    name @ 3 = 120:i8
+    check "[ok]" "[{}]" name
+
+do
+    using import C.stdio
+    let path = (module-dir .. "/_test_format_stream.txt")
+    let f = (fopen path "w")
+    do
+        local stream = (Stream f)
+        for i in (range 1000)
+            format-into stream "{} {}\n" i (i * 2)
+        # dropping the stream flushes it
+    fclose f
+    let f = (fopen path "r")
+    local line : (array i8 64)
+    fgets (& (line @ 0)) 64 f
+    test ((string (& (line @ 0)) 4:usize) == "0 0\n")
+    fseek f -9 SEEK_END
+    fgets (& (line @ 0)) 64 f
+    test ((string (& (line @ 0)) 9:usize) == "999 1998\n")
+    fclose f
+    remove path
 
 ;
\ No newline at end of file
@@ -210,6 +210,83 @@ do
     test ((m * (vec4 2 3 4 5)) == (vec3 21 30 52))
     test (((vec3 2 3 4) * m) == (vec4 27 22 20 28))
 
+test ((cross (vec3 1 0 0) (vec3 0 1 0)) == (vec3 0 0 1))
+test ((cross (vec3 2 3 4) (vec3 5 6 7)) == (vec3 -3 6 -3))
+
+do
+    # determinants and inverses of the square floating point matrices
+    test ((determinant (mat2 (vec2 4 2) (vec2 7 6))) == 10.0)
+    test
+        ==
+            inverse (mat2 (vec2 1 1) (vec2 0 2))
+            mat2 (vec2 1 -0.5) (vec2 0 0.5)
+
+    let m =
+        mat3
+            vec3 2 0 0
+            vec3 0 4 0
+            vec3 1 0 1
+    test ((determinant m) == 8.0)
+    test
+        ==
+            inverse m
+            mat3
+                vec3 0.5 0 0
+                vec3 0 0.25 0
+                vec3 -0.5 0 1
+
+    let m =
+        mat4
+            \ 3 3 3 1
+            \ 2 2 3 3
+            \ 1 2 3 4
+            \ 1 2 5 5
+    test ((determinant m) == 11.0)
+    test ((determinant (transpose m)) == 11.0)
+
+    let m =
+        mat4
+            vec4 2 0 0 0
+            vec4 0 4 0 0
+            vec4 0 0 8 0
+            vec4 1 2 3 1
+    let expected =
+        mat4
+            vec4 0.5 0 0 0
+            vec4 0 0.25 0 0
+            vec4 0 0 0.125 0
+            vec4 -0.5 -0.5 -0.375 1
+    test ((determinant m) == 64.0)
+    test ((inverse m) == expected)
+    test (((inverse m) * m) == (mat4))
+    test ((inverse (dmat4 m)) == (dmat4 expected))
+    test (((dmat4 m) * (dvec4 1 1 1 1)) == (dvec4 3 6 11 1))
+
+do
+    # batched transforms
+    let t =
+        mat4
+            vec4 1 0 0 0
+            vec4 0 1 0 0
+            vec4 0 0 1 0
+            vec4 5 6 7 1
+    local src = (arrayof vec4 (vec4 1 0 0 1) (vec4 0 1 0 1) (vec4 0 0 1 0))
+    local dest : (array vec4 3)
+    transform-many t src dest 3
+    test ((dest @ 0) == (vec4 6 6 7 1))
+    test ((dest @ 1) == (vec4 5 7 7 1))
+    test ((dest @ 2) == (vec4 0 0 1 0))
+    # in place
+    transform-many t src src 3
+    test ((src @ 2) == (vec4 0 0 1 0))
+    test ((src @ 0) == (vec4 6 6 7 1))
+
+    local points = (arrayof vec3 (vec3 1 2 3) (vec3 -5 -6 -7))
+    local out : (array vec3 2)
+    transform-points (mat4x3 t) points out 2
+    test ((out @ 0) == (vec3 6 8 10))
+    test ((out @ 1) == (vec3 0 0 0))
+
 test ((floor (ivec2 1 2)) == (ivec2 1 2))
 test ((floor (vec2 1.5 2.5)) == (vec2 1 2))
 
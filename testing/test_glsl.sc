@@ -264,4 +264,30 @@ do
         static-compile-glsl 420 'vertex (static-typify vertex)
 
 
+# batch compilation returns one result per job, in job order
+do
+    fn vert1 ()
+        gl_Position = (vec4 0 0 0 1)
+        ;
+    fn vert2 ()
+        gl_Position = (vec4 1 1 0 1)
+        ;
+
+    let versions = (alloca-array i32 2)
+    let targets = (alloca-array Symbol 2)
+    let funcs = (alloca-array Value 2)
+    let flags = (alloca-array u64 2)
+    let results = (alloca-array string 2)
+    versions @ 0 = 450
+    versions @ 1 = 450
+    targets @ 0 = 'vertex
+    targets @ 1 = 'vertex
+    funcs @ 0 = (Value (static-typify vert1))
+    funcs @ 1 = (Value (static-typify vert2))
+    flags @ 0 = 0:u64
+    flags @ 1 = 0:u64
+    sc_compile_glsl_batch 2 versions targets funcs flags results
+    test ((results @ 0) == (compile-glsl 450 'vertex (static-typify vert1)))
+    test ((results @ 1) == (compile-glsl 450 'vertex (static-typify vert2)))
+
 ;
@@ -61,3 +61,25 @@ test
     (abs ((degrees pi) - 180.0)) < 1e-30
 test
     (abs ((degrees pi:f64) - 180.0:f64)) < 1e-30
+
+# loops over transcendental functions may be vectorized with calls into a
+    vector math library; the results must agree with the scalar functions
+do
+    fn apply-all (src dest n)
+        for i in (range n)
+            let x = (src @ i)
+            dest @ i = ((sin x) + (tan x) + (atan2 x 2.0) + (tanh x))
+        ;
+    let apply-all-optimized =
+        (compile (typify apply-all (pointer f32) (mutable pointer f32) i32) 'O3)
+            as (pointer (function void (pointer f32) (mutable pointer f32) i32))
+    let N = 37
+    local src : (array f32 N)
+    local dest : (array f32 N)
+    for i in (range N)
+        src @ i = ((i as f32) / (N as f32))
+    apply-all-optimized (& (src @ 0)) (& (dest @ 0)) N
+    for i in (range N)
+        let x = (src @ i)
+        test
+            (abs ((dest @ i) - ((sin x) + (tan x) + (atan2 x 2.0) + (tanh x)))) < 1e-5
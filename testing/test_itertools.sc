@@ -180,4 +180,42 @@ do
         print i
 
 
-;
\ No newline at end of file
+;
+do
+    # counted sequences
+    using import Array
+
+    local xs = (arrayof f32 1.0 2.0 3.0 4.0 5.0 6.0 7.0 8.0 9.0 10.0)
+    local ys = (arrayof f32 10.0 9.0 8.0 7.0 6.0 5.0 4.0 3.0 2.0 1.0)
+
+    test ((countof (countable 5)) == 5)
+    test ((countof (cmap (do *) xs ys)) == 10)
+    test ((reduce 0:usize (do +) 5) == 10:usize)
+    test ((reduce 0.0 (do +) xs) == 55.0)
+    test ((reduce 0.0 (do +) (cmap (do *) xs ys)) == 220.0)
+    # vector lanes are summed at the end, the padding doesn't count
+    test ((reduce 0.0 (do +) (vectorize 4 xs)) == 55.0)
+    test ((reduce 0.0 (do +) (vectorize 8 (cmap (do *) xs ys))) == 220.0)
+    # non-associative folds keep their order
+    test ((reduce 0 (inline (acc x) (acc * 10 + x)) (cmap (inline (x) ((x as i32) + 1)) 3)) == 123)
+    test ((countof (vectorize 4 xs)) == 3)
+    test ((countof (chunked 3 xs)) == 4)
+    let n at = ((chunked 3 xs))
+    test ((countof (at 3:usize)) == 1)
+
+    local dst : (array f32 10)
+    test ((write-into (cmap (inline (x y) (2.0 * x + y)) xs ys) dst) == 10)
+    test ((dst @ 0) == 12.0)
+    test ((dst @ 9) == 21.0)
+    # writing into the source
+    write-into (cmap (inline (x) (x * x)) xs) xs
+    test ((xs @ 3) == 16.0)
+    test ((filter-into (inline (x) (x > 50.0)) xs dst) == 3)
+    test ((dst @ 0) == 64.0)
+    test ((dst @ 2) == 100.0)
+
+    # counted sequences can be iterated like generators
+    local sum = 0
+    for i in ((cmap (inline (x) ((x as i32) * 2)) 4) as Generator)
+        sum += i
+    test (sum == 12)
@@ -0,0 +1,43 @@
+using import testing
+using import C.stdlib
+
+# module functions are batched into one JIT module until one of them runs;
+    batching is opt-in, so the test runs a second time with it enabled
+if ((getenv "SCOPES_JIT_BATCH") == null)
+    setenv "SCOPES_JIT_BATCH" "1" 1
+    test ((system (report (.. compiler-path " " module-path))) == 0)
+
+global counter = 0
+
+fn square (x)
+    x * x
+
+fn bump (x)
+    counter += x
+    counter
+
+fn square-bump (x)
+    bump (square x)
+
+let T = (pointer (function i32 i32))
+let square-ptr = ((sc_compile (typify square i32) compile-flag-module) as T)
+let bump-ptr = ((sc_compile (typify bump i32) compile-flag-module) as T)
+let square-bump-ptr = ((sc_compile (typify square-bump i32) compile-flag-module) as T)
+
+test ((square-bump-ptr 3) == 9)
+test ((bump-ptr 1) == 10)
+test ((square-ptr 4) == 16)
+
+# functions compiled after the batch was emitted call into it
+fn bump-twice (x)
+    bump x
+    bump x
+let bump-twice-ptr = ((sc_compile (typify bump-twice i32) compile-flag-module) as T)
+test ((bump-twice-ptr 5) == 20)
+test (counter == 20)
+
+# a function that can't be linked is reported by compile, not by its stub
+fn call-missing ()
+    let f = (extern 'scopes_test_jit_batch_missing (function i32))
+    f;
+test-error (sc_compile (typify call-missing) compile-flag-module)
@@ -0,0 +1,62 @@
+using import testing
+using import C.string
+
+# released functions are unloaded by the next collection, unless code that
+# is still live refers to them
+
+fn square (x)
+    x * x
+
+fn square-plus-one (x)
+    (square x) + 1
+
+let T = (pointer (function i32 i32))
+
+let f = (sc_compile (typify square i32) 0:u64)
+test (((f as T) 3) == 9)
+sc_compile_release f
+test ((sc_compile_collect) >= 1)
+# a released function can't be released again
+test-error (sc_compile_release f)
+
+# compiling again after the unload generates the function anew
+let g = (sc_compile (typify square i32) 0:u64)
+test (((g as T) 4) == 16)
+
+let h = (sc_compile (typify square-plus-one i32) compile-flag-module)
+test (((h as T) 5) == 26)
+# square is still used by square-plus-one
+sc_compile_release g
+sc_compile_collect;
+test (((h as T) 6) == 37)
+sc_compile_release h
+test ((sc_compile_collect) >= 1)
+
+# a module stage is released once it has run; code compiled by the stage
+# that calls into it keeps it loaded until that code is released as well
+fn cube (x)
+    x * x * x
+
+fn cube-plus-one (x)
+    (cube x) + 1
+
+test ((cube 2) == 8)
+let k = (sc_compile (typify cube-plus-one i32) compile-flag-module)
+
+run-stage;
+
+sc_compile_collect;
+test (((k as T) 3) == 28)
+sc_compile_release k
+# unloads the unit of k, and the stage above unless it handed out the address
+    of one of its globals
+test ((sc_compile_collect) >= 1)
+
+# a unit that hands out the address of a constant stays loaded
+fn greeting ()
+    "hello" as rawstring
+let s = (sc_compile (typify greeting) compile-flag-module)
+let hello = ((s as (pointer (function rawstring))))
+sc_compile_release s
+sc_compile_collect;
+test ((strcmp hello "hello") == 0)
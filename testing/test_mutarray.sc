@@ -108,6 +108,18 @@ inline test-sort-array (T)
     'sort a (inline (x) (- x))
     va-lifold none verify-element reverse-sorted-sequence...
 
+    'stable-sort a
+    va-lifold none verify-element sorted-sequence...
+
+    'predicated-stable-sort a (inline (a b) (a > b))
+    va-lifold none verify-element reverse-sorted-sequence...
+
+    'radix-sort a
+    va-lifold none verify-element sorted-sequence...
+
+    'radix-sort a (inline (x) (- x))
+    va-lifold none verify-element reverse-sorted-sequence...
+
     print "POINTER" (imply a pointer)
     print "POINTER" (imply a voidstar)
     print "POINTER" (imply a (pointer i32))
@@ -160,6 +172,66 @@ fn test-sort ()
 
 test-sort;
 
+# many equal elements, presorted and reverse sorted input
+fn test-sort-patterns ()
+    let N = 100000
+    inline verify (a)
+        for i in (range 1 N)
+            test ((a @ (i - 1)) <= (a @ i))
+    local a : i32Array
+    for i in (range N)
+        'append a (i % 7)
+    'sort a
+    verify a
+    'sort a
+    verify a
+    'sort a (inline (x) (- x))
+    for i in (range 1 N)
+        test ((a @ (i - 1)) >= (a @ i))
+    'sort a
+    verify a
+
+test-sort-patterns;
+
+# elements with equal keys keep their order
+fn test-stable-sort ()
+    let N = 1000
+    inline verify (a)
+        for i in (range 1 N)
+            let x = (a @ (i - 1))
+            let y = (a @ i)
+            test ((x // 1000) <= (y // 1000))
+            if ((x // 1000) == (y // 1000))
+                test ((x % 1000) < (y % 1000))
+    inline fill (a)
+        'clear a
+        for i in (range N)
+            'append a (((i * 7919) % 100) * 1000 + i)
+    local a : i32Array
+    fill a
+    'stable-sort a (inline (x) (x // 1000))
+    verify a
+    fill a
+    'radix-sort a (inline (x) (x // 1000))
+    verify a
+
+test-stable-sort;
+
+fn test-radix-sort-reals ()
+    local a : (Array f32)
+    'append a -3.5
+    'append a 1.0
+    'append a -0.0
+    'append a 7.25
+    'append a -100.0
+    'append a 0.5
+    'append a 3.0
+    'radix-sort a
+    for i in (range 1 (countof a))
+        test ((a @ (i - 1)) <= (a @ i))
+
+test-radix-sort-reals;
+
 fn test-one ()
     One.test-refcount-balanced;
 
@@ -274,4 +346,65 @@ fn test-copy ()
 test-copy;
 One.test-refcount-balanced;
 
+# bulk append, insert and remove of plain elements
+do
+    local a : (Array i32)
+    local b : (Array i32)
+    for i in (range 1000)
+        'append b i
+    'append-many a b
+    'append-many a b
+    test ((countof a) == 2000)
+    test ((a @ 999) == 999)
+    test ((a @ 1000) == 0)
+    'remove-range a 10 1010
+    test ((countof a) == 1000)
+    test ((a @ 9) == 9)
+    test ((a @ 10) == 10)
+    test ((a @ 999) == 999)
+    local c = (arrayof i32 1 2 3)
+    'insert-range a 1 (& (c @ 0)) 3
+    test ((countof a) == 1003)
+    test ((a @ 0) == 0)
+    test ((a @ 1) == 1)
+    test ((a @ 3) == 3)
+    test ((a @ 4) == 1)
+    'insert-range a 0 b
+    test ((countof a) == 2003)
+    test ((a @ 999) == 999)
+    test ((a @ 1000) == 0)
+    local d = (copy a)
+    test (d == a)
+
+# bulk append, insert and remove of unique elements
+fn test-ranges ()
+    One.test-refcount-balanced;
+
+    local a =
+        (Array One)
+            One 0; One 1; One 2
+    local b =
+        (Array One)
+            One 3; One 4
+    'append-many a b
+    test ((One.refcount) == 7)
+    'insert-range a 1 b
+    test ((One.refcount) == 9)
+    test ((countof a) == 7)
+    test (('value (a @ 0)) == 0)
+    test (('value (a @ 1)) == 3)
+    test (('value (a @ 2)) == 4)
+    test (('value (a @ 3)) == 1)
+    test (('value (a @ 6)) == 4)
+    'remove-range a 1 4
+    test ((One.refcount) == 6)
+    test ((countof a) == 4)
+    test (('value (a @ 0)) == 0)
+    test (('value (a @ 1)) == 2)
+    test (('value (a @ 3)) == 4)
+    ;
+
+test-ranges;
+One.test-refcount-balanced;
+
 ;
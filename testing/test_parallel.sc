@@ -0,0 +1,107 @@
+using import testing
+using import Array
+using import Capture
+using import parallel
+
+test ((thread-count) >= 2)
+
+# futures
+do
+    let f = (spawn (fn () 42))
+    test (('wait f) == 42)
+
+    let a = 10
+    let f = (spawn (capture () {a} (a * 2)))
+    test (('wait f) == 20)
+
+    let x y = (join (spawn (fn () 1)) (spawn (fn () 2)))
+    test (x == 1)
+    test (y == 2)
+
+    local futures : (Array (Future i32))
+    for i in (range 100)
+        'append futures (spawn (capture () {i} (i * i)))
+    local sum = 0
+    while ((countof futures) > 0)
+        sum += ('wait ('pop futures))
+    test (sum == 328350)
+
+    global counter = 0
+    fn bump ()
+        atomicrmw add (& counter) 1
+        ;
+    'wait (spawn bump)
+    test (counter == 1)
+
+    # dropping a future waits for its task
+    do
+        let f = (spawn bump)
+        ;
+    test (counter == 2)
+
+# parallel loops
+do
+    let N = 100000
+    local data : (Array i32)
+    'resize data N 0
+    let ptr = (deref data._items)
+    parallel-for N
+        capture (i) {ptr}
+            (ptr @ i) = ((i as i32) * 2)
+    for i in (range N)
+        test ((data @ i) == (i * 2))
+
+    parallel-for data
+        fn (x)
+            x += 1
+    for i in (range N)
+        test ((data @ i) == (i * 2 + 1))
+
+    parallel-for 10 20
+        capture (i) {ptr}
+            (ptr @ i) = 0
+    test ((data @ 9) == 19)
+    test ((data @ 10) == 0)
+    test ((data @ 19) == 0)
+    test ((data @ 20) == 41)
+
+    # empty ranges do nothing
+    parallel-for 5 5
+        fn (i)
+            assert false
+
+    let total =
+        parallel-reduce N 0:i64
+            fn (acc i) (acc + i)
+            fn (a b) (a + b)
+    test (total == 4999950000:i64)
+
+    let total =
+        parallel-reduce data 0:i64
+            fn (acc x) (acc + (x as i64))
+            fn (a b) (a + b)
+    # sum of 2i+1 over all indices, minus the cleared elements 10..19
+    test (total == (10000000000:i64 - 300:i64))
+
+    test ((parallel-reduce 3 3 7 (fn (acc i) (acc + 1)) (fn (a b) (a + b))) == 7)
+
+# tasks can spawn and wait for more tasks
+do
+    let nested =
+        spawn
+            fn ()
+                parallel-reduce 1000 0
+                    fn (acc i) (acc + (i as i32))
+                    fn (a b) (a + b)
+    test (('wait nested) == 499500)
+
+# every index runs on a thread of its own
+do
+    local seen : (Array i32)
+    'resize seen 8 0
+    let ptr = (deref seen._items)
+    run-threads 8
+        capture (i) {ptr}
+            (ptr @ i) = ((i as i32) + 1)
+    for i in (range 8)
+        test ((seen @ i) == (i + 1))
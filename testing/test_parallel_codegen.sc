@@ -0,0 +1,63 @@
+using import testing
+using import C.stdio
+using import C.stdlib
+
+fn add (x y)
+    x + y
+
+fn mul (x y)
+    x * y
+
+# the partitions are written into a directory
+let dir = (module-dir .. "/test_parallel_codegen")
+let part0 = (dir .. "/0.o")
+let part1 = (dir .. "/1.o")
+let merged = (module-dir .. "/test_parallel_codegen.o")
+
+# don't pick up the outputs of an earlier run
+remove part0
+remove part1
+remove merged
+
+# ask for more than one partition
+static-if (operating-system == 'windows)
+    let _putenv = (extern '_putenv (function i32 rawstring))
+    _putenv "SCOPES_CODEGEN_THREADS=2"
+else
+    setenv "SCOPES_CODEGEN_THREADS" "2" 1
+
+compile-object
+    default-target-triple
+    compiler-file-kind-object
+    dir
+    do
+        let add = (static-typify add i32 i32)
+        let mul = (static-typify mul i32 i32)
+        locals;
+    'O2
+    'parallel
+
+inline shell (cmd)
+    (system (report cmd)) == 0
+
+# every function is defined in exactly one partition
+inline defined-in (sym path)
+    shell (.. "nm --defined-only " path " | grep -q ' T " sym "$'")
+test ((defined-in "add" part0) != (defined-in "add" part1))
+test ((defined-in "mul" part0) != (defined-in "mul" part1))
+
+# the partitions merge into a single object
+test (shell (.. "ld -r -o " merged " " part0 " " part1))
+test (defined-in "add" merged)
+test (defined-in "mul" merged)
+
+# the partitions can't be written to a single file
+test-error
+    compile-object
+        default-target-triple
+        compiler-file-kind-object
+        merged
+        do
+            let add = (static-typify add i32 i32)
+            locals;
+        'parallel
@@ -0,0 +1,49 @@
+using import testing
+
+fn hot (n)
+    loop (i acc = 0 0)
+        if (i == n)
+            break acc
+        repeat (i + 1)
+            if ((i % 3) == 0) (acc + i)
+            else (acc - 1)
+
+let hot-type = (pointer (function i32 i32))
+let profile-path = (module-dir .. "/test_pgo.profdata")
+
+# instrument, run and dump the collected counters
+let instrumented-value = (compile (typify hot i32) 'O3 'profile-generate)
+let instrumented = (instrumented-value as hot-type)
+let expected = (instrumented 1000)
+sc_profile_write profile-path
+
+# counters can be cleared between runs
+sc_profile_reset;
+for i in (range 3)
+    test ((instrumented 1000) == expected)
+sc_profile_write profile-path
+
+# feed the profile back into the optimizer; hot is generated anew rather
+# than reusing the instrumented version, and carries the counts from the
+# three runs after the reset
+sc_profile_set_input profile-path
+let optimized-value = (compile (typify hot i32) 'O3 'profile-use)
+let optimized = (optimized-value as hot-type)
+test ((optimized 1000) == expected)
+test ((sc_profile_entry_count optimized-value) == 3:usize)
+test ((sc_profile_entry_count instrumented-value) == 0:usize)
+test ((ptrtoint optimized usize) != (ptrtoint instrumented usize))
+
+# a profile that does not exist is rejected
+test-error (sc_profile_set_input (module-dir .. "/test_pgo_missing.profdata"))
+
+# compile-object picks up the same flag
+compile-object
+    default-target-triple
+    compiler-file-kind-object
+    module-dir .. "/test_pgo.o"
+    do
+        let hot = (static-typify hot i32)
+        locals;
+    'O3
+    'profile-use
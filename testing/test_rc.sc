@@ -90,6 +90,39 @@ do
 
 One.test-refcount-balanced;
 
+# atomic reference counting follows the same rules
+do
+    let a = (Arc.wrap (One 303))
+    let b = (Arc.new One 303)
+    'check a
+
+    let c = ((Arc vec3) 1 2 3)
+    test ((Rc.strong-count c) == 1)
+    test ((Rc.weak-count c) == 0)
+
+    let w = (c as Weak)
+    test ((typeof w) == (AtomicWeak vec3))
+    test ((Rc.strong-count w) == 1)
+    test ((Rc.weak-count w) == 1)
+
+    let v = ('force-upgrade w)
+    test ((Rc.strong-count c) == 2)
+    let w2 = (copy w)
+    test ((Rc.weak-count c) == 2)
+    drop w2
+    test ((Rc.weak-count c) == 1)
+
+    test (c.xz == (vec2 1 3))
+    drop c
+    drop v
+
+    test ((Rc.strong-count w) == 0)
+    test ((Rc.weak-count w) == 1)
+    test-error ('upgrade w)
+    ;
+
+One.test-refcount-balanced;
+
 # recursive declarations
 do
     using import struct
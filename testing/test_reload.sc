@@ -0,0 +1,61 @@
+using import testing
+using import C.stdio
+
+let path-a = (module-dir .. "/_test_reload_a.sc")
+let path-b = (module-dir .. "/_test_reload_b.sc")
+let path-c = (module-dir .. "/_test_reload_c.sc")
+
+fn write-file (path content)
+    let f = (fopen path "w")
+    assert (f != null)
+    fputs content f
+    fclose f
+    ;
+
+fn delete-file (path)
+    assert ((remove path) == 0)
+    ;
+
+write-file path-a "let x = 1\nlocals;\n"
+write-file path-b "import ._test_reload_a\nlet y = (_test_reload_a.x + 1)\nlocals;\n"
+write-file path-c "let z = 3\nlocals;\n"
+
+fn get (name key)
+    let module = ((require-from module-dir name __env) as Scope)
+    ('@ module key) as i32
+
+test ((get '._test_reload_b 'y) == 2)
+test ((get '._test_reload_c 'z) == 3)
+
+let path-a = (realpath path-a)
+let path-b = (realpath path-b)
+test ((countof (module-dependencies path-b)) == 1)
+test ((('@ (module-dependencies path-b)) as Symbol) == (Symbol path-a))
+test ((('@ (module-dependents path-a)) as Symbol) == (Symbol path-b))
+
+# nothing changed, nothing to reload
+test (empty? (reload-modules))
+
+# changing a reloads it and its dependents, but leaves c alone
+write-file path-a "let x = 10\nlocals;\n"
+let reloaded = (reload-modules)
+test ((countof reloaded) == 2)
+test ((get '._test_reload_b 'y) == 11)
+test ((get '._test_reload_c 'z) == 3)
+
+# a reload that fails leaves the previous versions in place
+write-file path-a "let x = (undefined-symbol + 1)\nlocals;\n"
+test-error (reload-modules)
+test ((get '._test_reload_b 'y) == 11)
+# and is retried by the next reload
+write-file path-a "let x = 100\nlocals;\n"
+test ((countof (reload-modules)) == 2)
+test ((get '._test_reload_b 'y) == 101)
+
+# a module whose file is gone fails to reload and keeps its previous version
+delete-file path-c
+test-error (reload-modules)
+test ((get '._test_reload_c 'z) == 3)
+
+delete-file path-a
+delete-file path-b
@@ -163,4 +163,65 @@ do
     local s = (String "0123456789")
     test ((slice s 2 7) == "23456")
 
+do
+    # short strings are stored inline, longer ones move to the heap
+    local s : String "0123456789abcde"
+    test ((countof s) == 15)
+    test (('capacity s) == 16)
+    local t = (copy s)
+    'append s "f"
+    test (s == "0123456789abcdef")
+    test (('capacity s) > 16)
+    test ((s @ 16) == 0:i8)
+    test (t == "0123456789abcde")
+    local u = (copy s)
+    'append u "g"
+    test (s == "0123456789abcdef")
+    test (u == "0123456789abcdefg")
+    test ((String "0123456789abcdefghij") == "0123456789abcdefghij")
+    ;
+
+do
+    # searching
+    local s = (String "the quick brown fox jumps over the lazy dog")
+    test (('find s "the") == 0)
+    test (('find s "the" 1) == 31)
+    test (('find s "cat") == -1:usize)
+    test (('find s 113:i8) == 4)
+    test (('find s "") == 0)
+    test (('rfind s "the") == 31)
+    test (('rfind s "the" 30) == 0)
+    test (('rfind s "cat") == -1:usize)
+    test (('find-any s "xyz") == 18)
+    test (('find-any s "!?") == -1:usize)
+    test (('rfind s "o") == 41)
+    test (('rfind s "o" 40) == 26)
+    test (('find-any s "q") == 4)
+    test (('find-any s "dg" 36) == 40)
+    test (('find-any s "zyxwvu") == 5)
+    test (('count s "o") == 4)
+    test (('count s (String "the")) == 2)
+    test (('count (String "aaaa") "aa") == 2)
+    test ('starts-with? s "the quick")
+    test (not ('starts-with? s "quick"))
+    test ('ends-with? s "lazy dog")
+    test (not ('ends-with? s "lazy"))
+
+do
+    # splitting
+    using import Array
+    local parts : (Array String)
+    for part in ('split (String "a,bc,,d,") ",")
+        'append parts part
+    test ((countof parts) == 5)
+    test ((parts @ 0) == "a")
+    test ((parts @ 1) == "bc")
+    test ((parts @ 2) == "")
+    test ((parts @ 3) == "d")
+    test ((parts @ 4) == "")
+    local n = 0
+    for part in ('split (String "one::two") "::")
+        n += 1
+    test (n == 2)
+
 ;
\ No newline at end of file
@@ -28,6 +28,16 @@ test-compiler-error
     test-error
         cause-compiler-error "this is a compiler error!"
 
+# benchmarks
+test ((black-box 42) == 42)
+let median =
+    bench "sum of 1000 integers"
+        local sum = 0
+        for i in (range (black-box 1000))
+            sum += i
+        black-box (deref sum)
+test (median > 0.0:f64)
+
 print "ok."
 
 
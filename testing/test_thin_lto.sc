@@ -0,0 +1,62 @@
+using import testing
+using import C.stdio
+using import C.stdlib
+
+# C code imported with a bitcode output takes part in the link
+vvv bind lib
+include
+    options "-c" (module-dir .. "/test_thin_lto_c.bc")
+    """"int thin_lto_scale(int x) { return x * 3; }
+
+fn get-scaled (x)
+    (lib.extern.thin_lto_scale x) + 1
+
+compile-object
+    default-target-triple
+    compiler-file-kind-bc
+    module-dir .. "/test_thin_lto.bc"
+    do
+        let get-scaled = (static-typify get-scaled i32)
+        locals;
+    'O2
+    'thin-lto
+
+# don't pick up the outputs of an earlier run
+remove (module-dir .. "/test_thin_lto.1.o")
+remove (module-dir .. "/test_thin_lto.2.o")
+
+thin-lto-link
+    default-target-triple
+    module-dir .. "/test_thin_lto.o"
+    list
+        module-dir .. "/test_thin_lto.bc"
+        module-dir .. "/test_thin_lto_c.bc"
+    'O2
+
+# one object per module with a summary
+inline test-exists (name)
+    let f = (fopen (module-dir .. name) "rb")
+    test (f != null)
+    fclose f
+test-exists "/test_thin_lto.1.o"
+test-exists "/test_thin_lto.2.o"
+
+inline shell (cmd)
+    (system (report cmd)) == 0
+
+# the C function was imported into get-scaled and inlined there, so that the
+    object of the first module no longer references it
+let scaled-object = (module-dir .. "/test_thin_lto.1.o")
+test (shell (.. "nm --defined-only " scaled-object " | grep -q ' T get-scaled$'"))
+test (not (shell (.. "nm -u " scaled-object " | grep -q thin_lto_scale")))
+
+# a summary can only be written to bitcode
+test-error
+    compile-object
+        default-target-triple
+        compiler-file-kind-object
+        module-dir .. "/test_thin_lto_bad.o"
+        do
+            let get-scaled = (static-typify get-scaled i32)
+            locals;
+        'thin-lto